@@ -0,0 +1,109 @@
+//
+// Created by wookie on 12/1/24.
+//
+
+#include "models/ShadingContext.h"
+#include "settings/Settings.h"
+#include "utils/LightSceneUtils.h"
+#include <QElapsedTimer>
+#include <QVector>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+
+// Shades a canvas-filling plane under a growing number of small lights, once with every light evaluated at every
+// pixel and once through the per-tile light lists, and prints the time per frame for both.
+
+namespace
+{
+constexpr int Width       = 700;
+constexpr int Height      = 700;
+constexpr int Repetitions = 5;
+// Behind the lights, which LightSceneUtils places at the depth of the orbit center
+constexpr float PlaneDepth = 0.4f;
+
+/// Milliseconds per frame, the sum of the irradiance is returned through checksum so nothing is optimized away
+double shadeFrame(const ShadingContext &context, double &checksum)
+{
+    QVector<int> rows(Height);
+    std::iota(rows.begin(), rows.end(), 0);
+    QVector<double> rowSums(Height);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int repetition = 0; repetition < Repetitions; ++repetition)
+    {
+        QtConcurrent::blockingMap(
+            rows,
+            [&context, &rowSums](const int y)
+            {
+                // L points from the light to the surface, the normal faces the lights in front of the plane
+                const QVector3D normal(0.0f, 0.0f, -1.0f);
+                double sum = 0.0;
+                for (int x = 0; x < Width; ++x)
+                {
+                    const QVector3D position((x + 0.5f) / Width, (y + 0.5f) / Height, PlaneDepth);
+                    const QVector3D light = context.irradiance(position, normal, x, y);
+                    sum += light.x() + light.y() + light.z();
+                }
+                rowSums[y] = sum;
+            }
+        );
+    }
+    const double elapsed = static_cast<double>(timer.nsecsElapsed()) / 1e6 / Repetitions;
+
+    checksum = std::accumulate(rowSums.begin(), rowSums.end(), 0.0);
+    return elapsed;
+}
+} // namespace
+
+int main()
+{
+    const Settings &settings        = Settings::getInstance();
+    LightSettings lightSettings     = settings.lightSettings;
+    ShadingSettings shadingSettings = settings.shadingSettings;
+    shadingSettings.shadows         = false;
+
+    std::printf(
+        "%6s %12s %12s %12s %9s %14s\n", "lights", "build ms", "all ms", "culled ms", "speedup", "lights/tile"
+    );
+    for (int lightCount : {1, 4, 16, 64, 128, 256})
+    {
+        const auto lights = LightSceneUtils::createSmallLights(
+            lightCount, lightSettings.smallLightRadius, lightSettings.orbitCenter.z()
+        );
+
+        ShadingContext unculled;
+        shadingSettings.lightCulling = false;
+        unculled.build(lights, lightSettings, shadingSettings, true, Width, Height);
+
+        ShadingContext culled;
+        shadingSettings.lightCulling = true;
+        QElapsedTimer buildTimer;
+        buildTimer.start();
+        culled.build(lights, lightSettings, shadingSettings, true, Width, Height);
+        const double buildTime = static_cast<double>(buildTimer.nsecsElapsed()) / 1e6;
+
+        double unculledSum    = 0.0;
+        double culledSum      = 0.0;
+        const double allTime  = shadeFrame(unculled, unculledSum);
+        const double cullTime = shadeFrame(culled, culledSum);
+
+        const int tileSize = shadingSettings.lightTileSize;
+        const int tiles    = ((Width + tileSize - 1) / tileSize) * ((Height + tileSize - 1) / tileSize);
+        std::printf(
+            "%6d %12.3f %12.3f %12.3f %8.2fx %14.2f\n", lightCount, buildTime, allTime, cullTime, allTime / cullTime,
+            static_cast<double>(culled.getLightGrid().getEntryCount()) / tiles
+        );
+
+        // Culling drops only lights whose falloff is zero, the image must not change
+        if (std::abs(unculledSum - culledSum) > 1e-3 * std::max(1.0, std::abs(unculledSum)))
+        {
+            std::printf("irradiance differs: %f all, %f culled\n", unculledSum, culledSum);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+//
+// Created by wookie on 12/1/24.
+//
+
+#include "geometry/BezierSurface.h"
+#include "graphics/QGraphicsEngine.h"
+#include "settings/Settings.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <cstdio>
+
+// Renders the Bezier surface of the demo through the whole engine with multisampling off, at 4x and at 8x, once at
+// the configured canvas size and once at twice its width and height, which is 2x2 supersampling when the frame is
+// downscaled for display. Prints the milliseconds per frame of each configuration.
+
+namespace
+{
+constexpr int WarmupFrames   = 3;
+constexpr int MeasuredFrames = 20;
+// Tilted, so the silhouette and the folds of the surface cross the pixel grid at arbitrary angles
+constexpr float RotationX = 35.0f;
+constexpr float RotationY = 20.0f;
+constexpr float RotationZ = 15.0f;
+
+/// Milliseconds per frame of a freshly built engine of the given size, frames are drawn on the calling thread
+double measureFrameTime(int width, int height, const QString &surfaceFile)
+{
+    Settings &settings                    = Settings::getInstance();
+    settings.graphicsEngineSettings.sizeX = width;
+    settings.graphicsEngineSettings.sizeY = height;
+    QGraphicsEngine engine(width, height);
+
+    QSharedPointer<QGraphicsEngineDrawable> surface(new BezierSurface(surfaceFile));
+    engine.addDrawable(surface);
+    QSharedPointer<LightSource> lightSource(new LightSource());
+    lightSource->setPosition(QVector3D(-0.5f, -0.5f, -0.5f));
+    engine.addLightSource(lightSource);
+    engine.setRotation(RotationX, RotationY, RotationZ);
+
+    for (int frame = 0; frame < WarmupFrames; ++frame)
+        engine.draw();
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < MeasuredFrames; ++frame)
+        engine.draw();
+    return static_cast<double>(timer.nsecsElapsed()) / 1e6 / MeasuredFrames;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // The engine queues its repaints to a context object, which needs an application even if nothing paints
+    QCoreApplication application(argc, argv);
+    const QString surfaceFile = argc > 1 ? QString(argv[1]) : QString("crazy.txt");
+
+    Settings &settings = Settings::getInstance();
+    // Every frame is rasterized, an unchanged scene would otherwise only be relit from the G-buffer
+    settings.shadingSettings.incrementalRelighting   = false;
+    settings.graphicsEngineSettings.dynamicResolution = false;
+    const int width                                   = settings.graphicsEngineSettings.sizeX;
+    const int height                                  = settings.graphicsEngineSettings.sizeY;
+
+    const Multisampling modes[] = {Multisampling::Off, Multisampling::X4, Multisampling::X8};
+    const char *names[]         = {"off", "4x", "8x"};
+    const int scales[]          = {1, 2};
+
+    std::printf("%s, %d frames per configuration\n", qPrintable(surfaceFile), MeasuredFrames);
+    std::printf("%12s %6s %12s %10s\n", "canvas", "msaa", "ms/frame", "vs 1x off");
+    double baseline = 0.0;
+    for (int scale : scales)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            settings.rasterizerSettings.multisampling = modes[i];
+            const double frameTime                    = measureFrameTime(width * scale, height * scale, surfaceFile);
+            if (baseline == 0.0)
+                baseline = frameTime;
+            std::printf(
+                "%5dx%-6d %6s %12.2f %9.2fx\n", width * scale, height * scale, names[i], frameTime,
+                frameTime / baseline
+            );
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+//
+// Created by wookie on 12/1/24.
+//
+
+#include "graphics/Texture.h"
+#include "settings/Settings.h"
+#include <QElapsedTimer>
+#include <QImage>
+#include <QSharedPointer>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+// Samples a texture the way the tile rasterizer walks a textured quad rotated about the view axis, for every
+// TextureLayout. Rotating the BezierSurface demo turns its UV gradient the same way, so at 90 degrees a screen row
+// runs down a texture column. Reports the miss rate of a simulated L1 data cache over the bilinear footprints and
+// the measured bilinear fetch throughput.
+
+namespace
+{
+constexpr int TextureSize = 2048;
+constexpr int ScreenSize  = 700;
+constexpr int Repetitions = 3;
+
+/// 32 KiB, 8-way set associative, 64-byte lines, least recently used replacement
+class CacheModel
+{
+    public:
+    CacheModel() : _tags(Sets * Ways, -1), _lastUse(Sets * Ways, 0) {}
+
+    void access(qint64 address)
+    {
+        const qint64 line = address / LineSize;
+        const int set     = static_cast<int>(line % Sets);
+        ++_accesses;
+
+        int victim = set * Ways;
+        for (int way = set * Ways; way < (set + 1) * Ways; ++way)
+        {
+            if (_tags[way] == line)
+            {
+                _lastUse[way] = _accesses;
+                return;
+            }
+            if (_lastUse[way] < _lastUse[victim])
+                victim = way;
+        }
+
+        ++_misses;
+        _tags[victim]    = line;
+        _lastUse[victim] = _accesses;
+    }
+
+    [[nodiscard]] double getMissRate() const
+    {
+        return _accesses == 0 ? 0.0 : static_cast<double>(_misses) / static_cast<double>(_accesses);
+    }
+
+    private:
+    static constexpr int LineSize = 64;
+    static constexpr int Ways     = 8;
+    static constexpr int Sets     = 32 * 1024 / (LineSize * Ways);
+
+    QVector<qint64> _tags;
+    QVector<qint64> _lastUse;
+    qint64 _accesses = 0;
+    qint64 _misses   = 0;
+};
+
+QImage createImage()
+{
+    QImage image(TextureSize, TextureSize, QImage::Format_ARGB32);
+    for (int y = 0; y < TextureSize; ++y)
+    {
+        auto *row = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < TextureSize; ++x)
+            row[x] = qRgb(x & 0xFF, y & 0xFF, (x ^ y) & 0xFF);
+    }
+    return image;
+}
+
+/// Calls fetch(u, v) for every pixel of the screen, tile by tile and row by row inside a tile like the
+/// tile binned rasterizer. One pixel steps one texel along the rotated axes.
+template <typename Fetch> void walkScreen(float angle, int tileSize, Fetch fetch)
+{
+    const float step = 1.0f / TextureSize;
+    const float cosA = std::cos(angle) * step;
+    const float sinA = std::sin(angle) * step;
+    for (int tileY = 0; tileY < ScreenSize; tileY += tileSize)
+    {
+        for (int tileX = 0; tileX < ScreenSize; tileX += tileSize)
+        {
+            for (int y = tileY; y < std::min(tileY + tileSize, ScreenSize); ++y)
+            {
+                for (int x = tileX; x < std::min(tileX + tileSize, ScreenSize); ++x)
+                {
+                    const float dx = static_cast<float>(x - ScreenSize / 2);
+                    const float dy = static_cast<float>(y - ScreenSize / 2);
+                    fetch(0.5f + dx * cosA - dy * sinA, 0.5f + dx * sinA + dy * cosA);
+                }
+            }
+        }
+    }
+}
+
+template <TextureLayout Layout> double simulateMissRate(const TexelGrid &grid, float angle, int tileSize)
+{
+    CacheModel cache;
+    walkScreen(
+        angle, tileSize,
+        [&grid, &cache](float u, float v)
+        {
+            const BilinearFootprint footprint = grid.bilinear<Layout>(u, v);
+            for (int index : {footprint.i00, footprint.i01, footprint.i10, footprint.i11})
+                cache.access(static_cast<qint64>(index) * static_cast<qint64>(sizeof(QRgb)));
+        }
+    );
+    return cache.getMissRate();
+}
+
+double simulateMissRate(TextureLayout layout, const TexelGrid &grid, float angle, int tileSize)
+{
+    switch (layout)
+    {
+        case TextureLayout::Tiled:
+            return simulateMissRate<TextureLayout::Tiled>(grid, angle, tileSize);
+        case TextureLayout::Morton:
+            return simulateMissRate<TextureLayout::Morton>(grid, angle, tileSize);
+        default:
+            return simulateMissRate<TextureLayout::RowMajor>(grid, angle, tileSize);
+    }
+}
+
+/// Millions of bilinear fetches per second on one thread, the fastest of a few runs
+double measureThroughput(const Texture &texture, float angle, int tileSize)
+{
+    double best      = std::numeric_limits<double>::max();
+    quint32 checksum = 0;
+    for (int repetition = 0; repetition < Repetitions; ++repetition)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        walkScreen(
+            angle, tileSize,
+            [&texture, &checksum](float u, float v)
+            {
+                checksum += texture.sample(u, v, 0.0f, TextureFilter::Bilinear);
+            }
+        );
+        best = std::min(best, static_cast<double>(timer.nsecsElapsed()));
+    }
+
+    // Keeps the fetches from being optimized away
+    if (checksum == 0x12345678u)
+        std::printf(" ");
+    return static_cast<double>(ScreenSize) * ScreenSize / (best / 1e9) / 1e6;
+}
+} // namespace
+
+int main()
+{
+    const int tileSize = Settings::getInstance().rasterizerSettings.tileSize;
+    const QImage image = createImage();
+
+    const TextureLayout layouts[] = {TextureLayout::RowMajor, TextureLayout::Tiled, TextureLayout::Morton};
+    const char *names[]           = {"row-major", "tiled", "morton"};
+    QVector<QSharedPointer<Texture>> textures;
+    for (TextureLayout layout : layouts)
+        textures.append(QSharedPointer<Texture>(new Texture(image, layout)));
+
+    std::printf(
+        "%dx%d texture, %dx%d screen in %d pixel tiles, bilinear at LOD 0\n", TextureSize, TextureSize, ScreenSize,
+        ScreenSize, tileSize
+    );
+    std::printf("%6s %10s %12s %12s\n", "angle", "layout", "L1 miss %", "Mfetch/s");
+    for (int degrees = 0; degrees <= 90; degrees += 15)
+    {
+        const float angle = static_cast<float>(degrees) * 3.14159265f / 180.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            const TexelGrid grid    = TexelGrid::create(layouts[i], TextureSize, TextureSize);
+            const double missRate   = 100.0 * simulateMissRate(layouts[i], grid, angle, tileSize);
+            const double throughput = measureThroughput(*textures[i], angle, tileSize);
+            std::printf("%6d %10s %12.2f %12.1f\n", degrees, names[i], missRate, throughput);
+        }
+    }
+    return 0;
+}
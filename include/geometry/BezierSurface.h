@@ -31,7 +31,7 @@ class BezierSurface : public Mesh
     void readControlPoints(const QString &filename);
     void map3dBezierFrom2dMesh();
 
-    void evaluateBezierSurface(Vertex &vertex) const;
+    void evaluateBezierSurface(int vertexIndex);
     void drawControlPointsAndGrid(DrawData &drawData);
 };
 
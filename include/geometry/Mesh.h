@@ -6,56 +6,88 @@
 #define BEZIERSURFACE_COMPUTERGRAPHICS_2024_MESH_H
 
 #include "Triangle.h"
+#include "graphics/NormalMap.h"
 #include "graphics/QGraphicsEngineDrawable.h"
+#include "graphics/Texture.h"
+#include "utils/VersionUtils.h"
 #include <QMatrix3x3>
 #include <QMatrix4x4>
 #include <QVector>
+#include <algorithm>
+
+/// Per-frame result of primitive assembly for one triangle of the mesh
+struct AssembledTriangle
+{
+    QRect screenBounds;
+    float nearestDepth;
+    PrimitiveVisibility visibility;
+};
 
 class Mesh : public QGraphicsEngineDrawable
 {
     public:
     // Constructors
     Mesh() = default;
-    [[maybe_unused]] explicit Mesh(const QVector<Triangle> &vertices);
-    [[maybe_unused]] explicit Mesh(QVector<Triangle> &&vertices);
+    [[maybe_unused]] Mesh(const VertexBuffer &vertices, const QVector<quint32> &indices);
+    [[maybe_unused]] Mesh(VertexBuffer &&vertices, QVector<quint32> &&indices);
 
     // Getters
-    [[maybe_unused]] [[nodiscard]] QVector<Triangle> getTriangles() const;
+    [[maybe_unused]] [[nodiscard]] const VertexBuffer &getVertices() const { return _vertices; }
+    [[maybe_unused]] [[nodiscard]] const QVector<quint32> &getIndices() const { return _indices; }
+    [[nodiscard]] int getTriangleCount() const { return _indices.size() / 3; }
+    [[nodiscard]] Triangle getTriangle(int index) const
+    {
+        return Triangle(_vertices, _indices[3 * index], _indices[3 * index + 1], _indices[3 * index + 2]);
+    }
     [[maybe_unused]] [[nodiscard]] QVector3D getPosition() const { return _position; }
     [[maybe_unused]] [[nodiscard]] QMatrix4x4 getModelMatrix() const { return _modelMatrix; }
 
-    [[nodiscard]] QSharedPointer<QImage> getTexture() const { return _texture; }
-    void setTexture(QSharedPointer<QImage> texture)
+    [[nodiscard]] QSharedPointer<Texture> getTexture() const { return _texture; }
+    /// Converts the image and builds its mip chain, a null or empty image removes the texture
+    void setTexture(const QSharedPointer<QImage> &image)
     {
+        QSharedPointer<Texture> texture = createTexture(image);
         QMutexLocker locker(&_mutex);
-        _texture = texture;
+        _texture         = texture;
+        _materialVersion = VersionUtils::next();
     }
 
-    [[nodiscard]] QSharedPointer<QImage> getNormalMap() const { return _normalMap; }
-    void setNormalMap(QSharedPointer<QImage> normalMap)
+    [[nodiscard]] QSharedPointer<NormalMap> getNormalMap() const { return _normalMap; }
+    /// Decodes the image into unit normals once, a null or empty image removes the normal map
+    void setNormalMap(const QSharedPointer<QImage> &image)
     {
+        QSharedPointer<NormalMap> normalMap = createNormalMap(image);
         QMutexLocker locker(&_mutex);
-        _normalMap = normalMap;
+        _normalMap       = normalMap;
+        _materialVersion = VersionUtils::next();
     }
 
     void setPosition(const QVector3D &position) { _position = position; }
 
+    [[maybe_unused]] [[nodiscard]] bool isTwoSided() const { return _twoSided; }
+    [[maybe_unused]] void setTwoSided(bool twoSided)
+    {
+        _twoSided        = twoSided;
+        _materialVersion = VersionUtils::next();
+    }
+
     // Tessellation
     [[maybe_unused]] static Mesh create2dTessellation(int tessellationLevel);
-    static QVector<Triangle> create2dTessellationTriangles(int tessellationLevel);
+    static void create2dTessellationGrid(int tessellationLevel, VertexBuffer &vertices, QVector<quint32> &indices);
 
     // Public Methods
     void draw(DrawData &drawData) override;
     void transform(QMatrix4x4 &matrix) override;
-
-    [[maybe_unused]] void loadTexture(const QString &path)
+    void castShadow(ShadowMap &shadowMap) override;
+    [[nodiscard]] quint64 getShadowVersion() const override { return _vertices.getPositionVersion(); }
+    [[nodiscard]] quint64 getSurfaceVersion() const override
     {
-        QMutexLocker locker(&_mutex);
-        setTexture(QSharedPointer<QImage>::create(QImage(path)));
+        return std::max(_vertices.getVersion(), _materialVersion);
     }
+
+    [[maybe_unused]] void loadTexture(const QString &path) { setTexture(QSharedPointer<QImage>::create(QImage(path))); }
     [[maybe_unused]] void loadNormalMap(const QString &path)
     {
-        QMutexLocker locker(&_mutex);
         setNormalMap(QSharedPointer<QImage>::create(QImage(path)));
     }
     void readFromFile(const QString &path);
@@ -64,14 +96,34 @@ class Mesh : public QGraphicsEngineDrawable
     protected:
     QVector3D _position;
     QMatrix4x4 _modelMatrix;
-    QVector<Triangle> _triangles;
-    QSharedPointer<QImage> _texture;
-    QSharedPointer<QImage> _normalMap;
+    VertexBuffer _vertices;
+    // Three vertex indices per triangle
+    QVector<quint32> _indices;
+    QVector<AssembledTriangle> _assembledTriangles;
+    // Atomic visibility resolve
+    QVector<int> _visibleTriangles;
+    QRect _visibleBounds;
+    QVector<int> _resolveRows;
+    // Indexed by triangle, filled for the visible triangles only
+    QVector<ResolveSetup> _resolveSetups;
+    QSharedPointer<Texture> _texture;
+    QSharedPointer<NormalMap> _normalMap;
     QMutex _mutex;
+    // Surfaces seen from both sides are never back-face culled
+    bool _twoSided = false;
+    // Texture, normal map and culling, the vertex buffer versions its own attributes
+    quint64 _materialVersion = VersionUtils::next();
 
     void sortTrianglesByDepth();
+    void assembleTriangles(DrawData &drawData);
+    void rasterizeTiles(DrawData &drawData);
+    void resolveVisibility(DrawData &drawData);
+    void drawVertices(DrawData &drawData) const;
 
     void calculateTangents();
+
+    static QSharedPointer<Texture> createTexture(const QSharedPointer<QImage> &image);
+    static QSharedPointer<NormalMap> createNormalMap(const QSharedPointer<QImage> &image);
 };
 
 #endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_MESH_H
@@ -5,21 +5,15 @@
 #ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_TRIANGLE_H
 #define BEZIERSURFACE_COMPUTERGRAPHICS_2024_TRIANGLE_H
 
-#include "Vertex.h"
-#include "graphics/QGraphicsEngineDrawable.h"
+#include "VertexBuffer.h"
+#include "graphics/Texture.h"
 #include "settings/Settings.h"
+#include <QRect>
+#include <QRectF>
+#include <array>
 
 class DrawData;
-
-struct VertexStruct
-{
-    float x, y, z;
-    QVector3D pos;
-    QVector3D normal;
-    float u, v;
-    QVector3D uTangent;
-    QVector3D vTangent;
-};
+struct QuadFragments;
 
 struct EdgeStruct
 {
@@ -28,33 +22,108 @@ struct EdgeStruct
     float xStep;
 };
 
-class Triangle : public QGraphicsEngineDrawable
+/// Outcome of primitive assembly for one triangle
+enum class PrimitiveVisibility
+{
+    // Back-facing or zero area
+    BackFacing,
+    OutsideViewport,
+    Visible,
+    // Reaches past the guard band and is clipped to it before rasterization
+    NeedsClipping
+};
+
+/// Per-triangle part of the visibility resolve, computed once per primitive and reused for every pixel it won
+struct ResolveSetup
+{
+    // Barycentric weights w1 and w2 are linear in the pixel offset from the first vertex, w0 = 1 - w1 - w2
+    float originX = 0.0f;
+    float originY = 0.0f;
+    float w1dx    = 0.0f;
+    float w1dy    = 0.0f;
+    float w2dx    = 0.0f;
+    float w2dy    = 0.0f;
+    SurfaceLod lod;
+};
+
+/// Lightweight view of three indexed vertices of a VertexBuffer, cheap to create on the fly
+class Triangle
 {
     public:
     // Constructors
-    [[maybe_unused]] Triangle(Vertex a, Vertex b, Vertex c);
+    Triangle(const VertexBuffer &vertices, quint32 a, quint32 b, quint32 c);
 
     // Getters
-    [[maybe_unused]] [[nodiscard]] Vertex &getA() { return _a; }
-    [[maybe_unused]] [[nodiscard]] Vertex &getB() { return _b; }
-    [[maybe_unused]] [[nodiscard]] Vertex &getC() { return _c; }
-    [[maybe_unused]] [[nodiscard]] Vertex getA() const { return _a; }
-    [[maybe_unused]] [[nodiscard]] Vertex getB() const { return _b; }
-    [[maybe_unused]] [[nodiscard]] Vertex getC() const { return _c; }
+    [[maybe_unused]] [[nodiscard]] quint32 getIndex(int corner) const { return _indices[corner]; }
 
     // Public Methods
-    void draw(DrawData &drawData) override;
-    void transform(QMatrix4x4 &matrix) override;
-
-    // Operators
-    Vertex &operator[](int i);
-    auto begin() { return std::array<Vertex *, 3>{&_a, &_b, &_c}.begin(); }
-    auto end() { return std::array<Vertex *, 3>{&_a, &_b, &_c}.end(); }
+    /// Rasterizes only the pixels inside clipRect, used by the tile binned renderer.
+    /// Reads the screen vertices, so VertexBuffer::updateScreenVertices has to run first.
+    void rasterize(DrawData &drawData, const QRect &clipRect, bool clipToGuardBand = false);
+    /// First pass of the atomic visibility resolve, coverage and depth only, safe to run for many triangles at once
+    void rasterizeVisibility(DrawData &drawData, quint32 primitiveId, bool clipToGuardBand = false) const;
+    /// Edge functions and mip levels of the second pass, depends on the bound texture and normal map
+    [[nodiscard]] ResolveSetup prepareResolve(const DrawData &drawData) const;
+    /// Second pass, shades pixel (x, y) after the visibility buffer picked this triangle for it
+    void resolveFragment(DrawData &drawData, Settings &settings, const ResolveSetup &setup, int x, int y) const;
+    void drawVertices(DrawData &drawData) const;
+    [[nodiscard]] QRect getScreenBounds() const;
+    [[nodiscard]] float getNearestDepth() const;
+    /// Front faces wind counter-clockwise in screen space, which is a positive signed area
+    [[nodiscard]] PrimitiveVisibility
+    classify(int width, int height, const QRect &screenBounds, bool cullBackFaces, int guardBand) const;
+    [[nodiscard]] std::array<VertexStruct, 3> getScreenVertices() const;
 
     private:
-    Vertex _a;
-    Vertex _b;
-    Vertex _c;
+    const VertexBuffer *_vertices;
+    std::array<quint32, 3> _indices;
+
+    template <typename Function>
+    static void forEachClippedTriangle(
+        const std::array<VertexStruct, 3> &vertices, int width, int height, int guardBand, Function function
+    );
+    static void rasterizeVertices(
+        DrawData &drawData, Settings &settings, const std::array<VertexStruct, 3> &vertices, const QRect &clipRect
+    );
+    static int clipToRect(
+        const std::array<VertexStruct, 3> &vertices, const QRectF &rect, std::array<VertexStruct, 9> &polygon
+    );
+    static VertexStruct lerpVertex(const VertexStruct &a, const VertexStruct &b, float t);
+    static UvGradient computeUvGradient(const std::array<VertexStruct, 3> &vertices);
+
+    static void
+    rasterizeVisibilityVertices(DrawData &drawData, const std::array<VertexStruct, 3> &vertices, quint32 primitiveId);
+
+    static void rasterizeScanline(
+        DrawData &drawData, Settings &settings, std::array<VertexStruct, 3> vertices, const QRect &clipRect,
+        const SurfaceLod &lod
+    );
+    static void rasterizeHalfSpace(
+        DrawData &drawData, Settings &settings, const std::array<VertexStruct, 3> &vertices, const QRect &clipRect,
+        const SurfaceLod &lod, bool useQuadKernel
+    );
+    static void rasterizeMultisampled(
+        DrawData &drawData, Settings &settings, const std::array<VertexStruct, 3> &vertices, const QRect &clipRect,
+        const SurfaceLod &lod
+    );
+    static void drawFragment(
+        DrawData &drawData, Settings &settings, const std::array<VertexStruct, 3> &vertices,
+        const QVector3D &barycentric, const SurfaceLod &lod, int x, int y
+    );
+    /// Interpolates the vertex attributes at the barycentric coordinates and shades pixel (x, y), no depth test
+    static void shadeBarycentric(
+        DrawData &drawData, Settings &settings, const std::array<VertexStruct, 3> &vertices,
+        const QVector3D &barycentric, const SurfaceLod &lod, int x, int y
+    );
+    static void shadeQuadLane(
+        DrawData &drawData, Settings &settings, const QuadFragments &fragments, int lane, const SurfaceLod &lod, int x,
+        int y
+    );
+    static void shadeFragment(
+        DrawData &drawData, Settings &settings, const QVector3D &barycentric, const QVector3D &pos, QVector3D normal,
+        float u, float v, const QVector3D &uTangent, const QVector3D &vTangent, const QVector3D &irradiance,
+        const SurfaceLod &lod, int x, int y
+    );
 
     static QVector3D
     computeBarycentricCoordinates(const QVector2D &p, const QVector2D &a, const QVector2D &b, const QVector2D &c);
@@ -63,13 +132,6 @@ class Triangle : public QGraphicsEngineDrawable
         DrawData &drawData, Settings &settings, int y, int x, const QVector3D &barycentric, const QVector3D &pos,
         const QVector3D &normal
     );
-
-    static QColor &getColor(const DrawData &drawData, float u, float v, QColor &color);
-
-    static void getNormalFromMap(
-        const DrawData &drawData, const std::array<VertexStruct, 3> &vertices, float u, float v, QVector3D &normal,
-        const QVector3D &uTangent, const QVector3D &vTangent
-    );
 };
 
 #endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_TRIANGLE_H
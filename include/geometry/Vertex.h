@@ -37,6 +37,11 @@ class Vertex : public QGraphicsEngineDrawable
     [[maybe_unused]] [[nodiscard]] QVector3D &getUTangentTransformed() { return _uTangentTransformed; }
     [[maybe_unused]] [[nodiscard]] QVector3D &getVTangentTransformed() { return _vTangentTransformed; }
 
+    [[maybe_unused]] [[nodiscard]] const QVector3D &getPositionTransformed() const { return _positionTransformed; }
+    [[maybe_unused]] [[nodiscard]] const QVector3D &getNormalTransformed() const { return _normalTransformed; }
+    [[maybe_unused]] [[nodiscard]] const QVector3D &getUTangentTransformed() const { return _uTangentTransformed; }
+    [[maybe_unused]] [[nodiscard]] const QVector3D &getVTangentTransformed() const { return _vTangentTransformed; }
+
     [[maybe_unused]] void setPositionOriginal(const QVector3D &vector3D)
     {
         _positionOriginal    = vector3D;
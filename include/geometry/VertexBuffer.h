@@ -0,0 +1,129 @@
+//
+// Created by wookie on 11/21/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_VERTEXBUFFER_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_VERTEXBUFFER_H
+
+#include "Vertex.h"
+#include "utils/VersionUtils.h"
+#include <QMatrix4x4>
+#include <QVector2D>
+#include <QVector3D>
+#include <QVector>
+
+class ShadingContext;
+
+/// Post-transform vertex in screen space, x and y in pixels and the normal normalized
+struct VertexStruct
+{
+    float x, y, z;
+    QVector3D pos;
+    QVector3D normal;
+    float u, v;
+    QVector3D uTangent;
+    QVector3D vTangent;
+    // Per-vertex lighting only
+    QVector3D irradiance;
+};
+
+/// Unique vertices of a mesh, one array per attribute, with the model-space originals and the transformed copies.
+/// Triangles refer to the vertices by index, so a vertex shared by several triangles is stored and transformed once.
+class VertexBuffer
+{
+    public:
+    // Getters
+    [[nodiscard]] int size() const { return _positions.size(); }
+
+    [[nodiscard]] const QVector<QVector3D> &getPositions() const { return _positions; }
+    [[nodiscard]] const QVector<QVector3D> &getNormals() const { return _normals; }
+    [[nodiscard]] const QVector<QVector3D> &getUTangents() const { return _uTangents; }
+    [[nodiscard]] const QVector<QVector3D> &getVTangents() const { return _vTangents; }
+    [[nodiscard]] const QVector<QVector2D> &getUvs() const { return _uvs; }
+
+    [[nodiscard]] const QVector<QVector3D> &getPositionsTransformed() const { return _positionsTransformed; }
+    [[nodiscard]] const QVector<QVector3D> &getNormalsTransformed() const { return _normalsTransformed; }
+    [[nodiscard]] const QVector<QVector3D> &getUTangentsTransformed() const { return _uTangentsTransformed; }
+    [[nodiscard]] const QVector<QVector3D> &getVTangentsTransformed() const { return _vTangentsTransformed; }
+
+    [[nodiscard]] const QVector<VertexStruct> &getScreenVertices() const { return _screenVertices; }
+    /// Changes whenever a transformed position does, unique across buffers
+    [[nodiscard]] quint64 getPositionVersion() const { return _positionVersion; }
+    /// Changes whenever any attribute does
+    [[nodiscard]] quint64 getVersion() const { return _version; }
+
+    /// Copy of a single vertex, for the debug overlay
+    [[nodiscard]] Vertex getVertex(int index) const;
+
+    // Setters, like Vertex they reset the transformed copy as well
+    void setPosition(int index, const QVector3D &position)
+    {
+        _positions[index]            = position;
+        _positionsTransformed[index] = position;
+        _screenVerticesValid         = false;
+        _positionVersion             = VersionUtils::next();
+        _version                     = _positionVersion;
+    }
+    void setNormal(int index, const QVector3D &normal)
+    {
+        _normals[index]            = normal;
+        _normalsTransformed[index] = normal;
+        _screenVerticesValid       = false;
+        _version                   = VersionUtils::next();
+    }
+    void setUTangent(int index, const QVector3D &uTangent)
+    {
+        _uTangents[index]            = uTangent;
+        _uTangentsTransformed[index] = uTangent;
+        _screenVerticesValid         = false;
+        _version                     = VersionUtils::next();
+    }
+    void setVTangent(int index, const QVector3D &vTangent)
+    {
+        _vTangents[index]            = vTangent;
+        _vTangentsTransformed[index] = vTangent;
+        _screenVerticesValid         = false;
+        _version                     = VersionUtils::next();
+    }
+    void setUv(int index, float u, float v)
+    {
+        _uvs[index]          = QVector2D(u, v);
+        _screenVerticesValid = false;
+        _version             = VersionUtils::next();
+    }
+
+    // Public Methods
+    int append(const QVector3D &position, const QVector3D &normal = QVector3D(0, 0, 0), float u = 0, float v = 0);
+    void reserve(int size);
+    void clear();
+    void transform(const QMatrix4x4 &matrix);
+    /// Refreshes the post-transform cache, a no-op unless the vertices or the canvas size changed.
+    /// Cached vertices carry an orthonormal tangent frame, ready for normal mapping.
+    void updateScreenVertices(int width, int height);
+    /// Lights every cached screen vertex, used when the shading context asks for per-vertex lighting
+    void updateVertexLighting(const ShadingContext &shading);
+
+    private:
+    QVector<QVector3D> _positions;
+    QVector<QVector3D> _normals;
+    QVector<QVector3D> _uTangents;
+    QVector<QVector3D> _vTangents;
+    QVector<QVector2D> _uvs;
+
+    QVector<QVector3D> _positionsTransformed;
+    QVector<QVector3D> _normalsTransformed;
+    QVector<QVector3D> _uTangentsTransformed;
+    QVector<QVector3D> _vTangentsTransformed;
+
+    QVector<VertexStruct> _screenVertices;
+    int _screenWidth          = 0;
+    int _screenHeight         = 0;
+    bool _screenVerticesValid = false;
+    quint64 _positionVersion  = VersionUtils::next();
+    quint64 _version          = _positionVersion;
+    template <typename Function> void forEachBlock(Function function) const;
+
+    static void orthonormalizeFrame(const QVector3D &normal, QVector3D &uTangent, QVector3D &vTangent);
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_VERTEXBUFFER_H
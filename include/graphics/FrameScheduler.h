@@ -0,0 +1,53 @@
+//
+// Created by wookie on 11/29/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_FRAMESCHEDULER_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_FRAMESCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+/// Paces the render thread and runs the fixed-timestep clock the animation advances on. Frames begin no earlier
+/// than one target period after the previous one; a frame that runs late moves the schedule instead of being
+/// followed by a burst of catch-up frames. The simulation advances in whole 60 Hz steps, so the light motion does
+/// not depend on how fast frames are delivered.
+class FrameScheduler
+{
+    public:
+    static constexpr int StepsPerSecond   = 60;
+    static constexpr int MaxStepsPerFrame = 4;
+
+    // Getters
+    /// Duration of the last frame in milliseconds, from beginFrame to endFrame
+    [[maybe_unused]] [[nodiscard]] double getFrameTime() const { return _frameTime; }
+    /// Exponential moving average of the frame duration in milliseconds
+    [[maybe_unused]] [[nodiscard]] double getAverageFrameTime() const { return _averageFrameTime; }
+    [[maybe_unused]] [[nodiscard]] float getSimulationTime() const
+    {
+        return static_cast<float>(_simulationSteps) / StepsPerSecond;
+    }
+
+    // Public Methods
+    void start();
+    /// Milliseconds to wait before the next frame may begin, 0 when it is due or the rate is unlimited
+    [[nodiscard]] qint64 getFrameDelay(int targetFps) const;
+    /// Starts timing a frame and returns the simulation steps it has to run. A paused simulation drops the
+    /// time that passed, so resuming does not make the lights jump.
+    int beginFrame(int targetFps, bool simulate);
+    void endFrame();
+
+    private:
+    QElapsedTimer _clock;
+    // Nanoseconds on the clock
+    qint64 _nextFrameStart = 0;
+    qint64 _frameStart     = 0;
+    qint64 _lastStepTime   = 0;
+    qint64 _accumulator    = 0;
+
+    qint64 _simulationSteps  = 0;
+    double _frameTime        = 0.0;
+    double _averageFrameTime = 0.0;
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_FRAMESCHEDULER_H
@@ -0,0 +1,122 @@
+//
+// Created by wookie on 11/20/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_FRAMEBUFFER_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_FRAMEBUFFER_H
+
+#include <QColor>
+#include <QImage>
+#include <QRect>
+#include <QVector2D>
+#include <QVector>
+
+/// Color target of the renderer. Drawing writes linear float red, green and blue planes; resolve() clamps, quantizes
+/// and packs them into a Format_ARGB32 image in one parallel pass. Neither buffer is ever shared, so the pointers
+/// taken on resize stay valid and writes never detach.
+/// With more than one sample per pixel the buffer also keeps color and depth for every sample. The multisampled
+/// rasterizer stores a shaded pixel into the samples it covers and resolveSamples() averages them back into the planes.
+class Framebuffer
+{
+    public:
+    // Constructors
+    Framebuffer() = default;
+    Framebuffer(int width, int height);
+    Framebuffer(const Framebuffer &)            = delete;
+    Framebuffer &operator=(const Framebuffer &) = delete;
+
+    // Getters
+    [[nodiscard]] int width() const { return _width; }
+    [[nodiscard]] int height() const { return _height; }
+    /// Resolved pixels, current as of the last resolve()
+    [[nodiscard]] const QRgb *row(int y) const { return _pixels + y * _width; }
+    /// For presenting only, the reference must not be copied while rendering continues
+    [[nodiscard]] const QImage &image() const { return _image; }
+    /// Deep copy, safe to keep after the next frame
+    [[nodiscard]] QImage toImage() const { return _image.copy(); }
+
+    [[nodiscard]] int getSampleCount() const { return _sampleCount; }
+    /// Sample positions relative to the pixel center in pixels, getSampleCount() of them
+    [[nodiscard]] const QVector2D *getSampleOffsets() const;
+    /// Depth of the samples of pixel (x, y), larger is nearer
+    [[nodiscard]] float *sampleDepth(int x, int y) { return _sampleDepth + (y * _width + x) * _sampleCount; }
+
+    // Public Methods
+    void resize(int width, int height);
+    /// 1, 4 or 8, the sample buffers are only allocated when the count changes
+    void setSampleCount(int sampleCount);
+    /// Also resets every sample to the color and to the farthest depth
+    void fill(QRgb color);
+    /// No bounds checks, x and y must lie inside the buffer. Channels may leave [0, 1], the resolve clamps them.
+    void setPixelF(int x, int y, float r, float g, float b)
+    {
+        const int index = y * _width + x;
+        _red[index]     = r;
+        _green[index]   = g;
+        _blue[index]    = b;
+    }
+    void setPixel(int x, int y, QRgb color)
+    {
+        setPixelF(x, y, qRed(color) * ByteToFloat, qGreen(color) * ByteToFloat, qBlue(color) * ByteToFloat);
+    }
+    void setPixel(int x, int y, const QColor &color) { setPixel(x, y, color.rgb()); }
+    /// Copies the color of pixel (x, y) into the samples set in the coverage mask
+    void storeSamples(int x, int y, quint32 coverage)
+    {
+        const int pixel  = y * _width + x;
+        const int sample = pixel * _sampleCount;
+        for (int i = 0; i < _sampleCount; ++i)
+        {
+            if (!(coverage & (1u << i)))
+                continue;
+            _sampleRed[sample + i]   = _red[pixel];
+            _sampleGreen[sample + i] = _green[pixel];
+            _sampleBlue[sample + i]  = _blue[pixel];
+        }
+        _dirty[pixel] = 1;
+    }
+    /// Averages the samples of every pixel inside rect stored to since its last resolve. Pixels nothing was stored to
+    /// keep what was drawn into them directly.
+    void resolveSamples(const QRect &rect);
+    /// Packs the float planes into the image, every pixel comes out opaque
+    void resolve();
+    /// Exchanges the resolved image with another one of the same size, which becomes the next resolve target
+    void swapImage(QImage &image);
+
+    /// Packs clamped [0, 1] channels into an opaque ARGB32 value
+    static QRgb packRgbF(float r, float g, float b)
+    {
+        const auto toByte = [](float channel) { return static_cast<int>(channel * 255.0f + 0.5f); };
+        return qRgb(toByte(r), toByte(g), toByte(b));
+    }
+
+    static constexpr float ByteToFloat = 1.0f / 255.0f;
+
+    private:
+    int _width    = 0;
+    int _height   = 0;
+    QRgb *_pixels = nullptr;
+    QImage _image;
+
+    // Three planes of width * height floats
+    QVector<float> _accumulation;
+    float *_red   = nullptr;
+    float *_green = nullptr;
+    float *_blue  = nullptr;
+
+    // Four planes of width * height * sampleCount floats, the samples of a pixel are adjacent
+    int _sampleCount = 1;
+    QVector<float> _samples;
+    float *_sampleRed   = nullptr;
+    float *_sampleGreen = nullptr;
+    float *_sampleBlue  = nullptr;
+    float *_sampleDepth = nullptr;
+    // Pixels stored to since their last resolveSamples()
+    QVector<quint8> _sampleDirty;
+    quint8 *_dirty = nullptr;
+
+    void allocateSamples();
+    void resolveRow(int y);
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_FRAMEBUFFER_H
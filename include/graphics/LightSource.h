@@ -6,6 +6,7 @@
 #define BEZIERSURFACE_COMPUTERGRAPHICS_2024_LIGHTSOURCE_H
 
 #include "QGraphicsEngineDrawable.h"
+#include "models/ShadowMap.h"
 #include <QVector3D>
 #include <cmath>
 
@@ -24,6 +25,17 @@ class LightSource : public QGraphicsEngineDrawable
     QColor getColor() const { return color; }
     void setColor(QColor color) { this->color = color; }
 
+    /// Distance at which the light has faded out completely, 0 for a light that reaches everything
+    float getRadius() const { return radius; }
+    void setRadius(float radius) { this->radius = radius; }
+
+    /// Orbiting lights are moved by the animation, the others stay where they were put
+    bool isOrbiting() const { return orbiting; }
+    void setOrbiting(bool orbiting) { this->orbiting = orbiting; }
+
+    ShadowMap &getShadowMap() { return shadowMap; }
+    const ShadowMap &getShadowMap() const { return shadowMap; }
+
     // Public methods
     QVector3D calcVersorTo(QVector3D point) const { return (point - position).normalized(); }
 
@@ -35,6 +47,10 @@ class LightSource : public QGraphicsEngineDrawable
     QVector3D position;
     QVector3D direction;
     QColor color;
+    float radius  = 0.0f;
+    bool orbiting = true;
+    // Cached depth of the casters, rendered again only when the light or a caster moves
+    ShadowMap shadowMap;
 };
 
 #endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_LIGHTSOURCE_H
@@ -0,0 +1,53 @@
+//
+// Created by wookie on 11/25/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_NORMALMAP_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_NORMALMAP_H
+
+#include "graphics/TexelGrid.h"
+#include "settings/ShadingSettings.h"
+#include <QImage>
+#include <QVector3D>
+#include <QVector>
+
+/// Tangent-space normals decoded once from an RGB image into unit float vectors, mip-mapped like Texture.
+/// Filtered samples are not renormalized; the shading code normalizes once after the tangent frame transform.
+class NormalMap
+{
+    public:
+    // Constructors
+    explicit NormalMap(const QImage &image, TextureLayout layout = TextureLayout::RowMajor);
+
+    // Getters
+    [[maybe_unused]] [[nodiscard]] int getWidth() const { return _levels[0].grid.width; }
+    [[maybe_unused]] [[nodiscard]] int getHeight() const { return _levels[0].grid.height; }
+    [[maybe_unused]] [[nodiscard]] int getLevelCount() const { return _levels.size(); }
+
+    // Public Methods
+    [[nodiscard]] float computeLod(const UvGradient &gradient) const
+    {
+        return _levels[0].grid.computeLod(gradient, static_cast<float>(_levels.size() - 1));
+    }
+    [[nodiscard]] QVector3D sample(float u, float v, float lod, TextureFilter filter) const;
+
+    private:
+    struct MipLevel
+    {
+        TexelGrid grid;
+        QVector<QVector3D> normals;
+    };
+
+    TextureLayout _layout;
+    QVector<MipLevel> _levels;
+
+    void buildMipChain();
+    [[nodiscard]] int nearestLevel(float lod) const;
+
+    template <TextureLayout Layout>
+    [[nodiscard]] QVector3D sampleLayout(float u, float v, float lod, TextureFilter filter) const;
+    template <TextureLayout Layout>
+    static QVector3D sampleBilinear(const MipLevel &level, float u, float v);
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_NORMALMAP_H
@@ -0,0 +1,83 @@
+//
+// Created by wookie on 11/17/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_PIXELQUADKERNEL_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_PIXELQUADKERNEL_H
+
+#include "geometry/Triangle.h"
+#include <array>
+
+enum QuadAttribute
+{
+    QuadZ,
+    QuadPosX,
+    QuadPosY,
+    QuadPosZ,
+    QuadNormalX,
+    QuadNormalY,
+    QuadNormalZ,
+    QuadU,
+    QuadV,
+    // Interpolated with per-vertex lighting or when tangents are
+    QuadIrradianceR,
+    QuadIrradianceG,
+    QuadIrradianceB,
+    // Tangents are interpolated only when a normal map is bound
+    QuadUTangentX,
+    QuadUTangentY,
+    QuadUTangentZ,
+    QuadVTangentX,
+    QuadVTangentY,
+    QuadVTangentZ,
+    QuadAttributeCount
+};
+
+/// Per-triangle vertex attributes in structure-of-arrays form, one row of three corner values per attribute
+struct QuadSetup
+{
+    float attributes[QuadAttributeCount][3];
+    int attributeCount;
+};
+
+/// Output of one kernel step, lane i is the pixel (x + i, y)
+struct QuadFragments
+{
+    alignas(16) float w0[4];
+    alignas(16) float w1[4];
+    alignas(16) float w2[4];
+    alignas(16) float attributes[QuadAttributeCount][4];
+};
+
+/// Coverage, depth test and attribute interpolation for a horizontal run of four pixels.
+/// The SSE2 and scalar variants perform the same IEEE operations in the same order, so they are bit-identical.
+class PixelQuadKernel
+{
+    public:
+    static constexpr int QuadWidth = 4;
+
+    static QuadSetup
+    createSetup(const std::array<VertexStruct, 3> &vertices, bool withIrradiance, bool withTangents);
+
+    /// Lane i uses the weights w1 + i * w1StepX and w2 + i * w2StepX. Depths of lanes that are covered and pass the
+    /// depth test are written to depthRow. Returns the bitmask of those lanes.
+    static int processQuad(
+        const QuadSetup &setup, float w1, float w2, float w1StepX, float w2StepX, float *depthRow, int laneCount,
+        QuadFragments &fragments
+    );
+
+    static int processQuadScalar(
+        const QuadSetup &setup, float w1, float w2, float w1StepX, float w2StepX, float *depthRow, int laneCount,
+        QuadFragments &fragments
+    );
+
+    private:
+#if defined(__SSE2__)
+    static int processQuadSse(
+        const QuadSetup &setup, float w1, float w2, float w1StepX, float w2StepX, float *depthRow,
+        QuadFragments &fragments
+    );
+#endif
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_PIXELQUADKERNEL_H
@@ -5,31 +5,60 @@
 #ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_QGRAPHICSENGINE_H
 #define BEZIERSURFACE_COMPUTERGRAPHICS_2024_QGRAPHICSENGINE_H
 
+#include "FrameScheduler.h"
+#include "Framebuffer.h"
 #include "LightSource.h"
 #include "QGraphicsEngineDrawable.h"
+#include "ResolutionScaler.h"
+#include "models/GBuffer.h"
+#include "models/RenderStats.h"
+#include "models/RenderTargets.h"
+#include "models/ShadingContext.h"
+#include "models/VisibilityBuffer.h"
+#include "settings/Settings.h"
 #include <QGraphicsItem>
+#include <QImage>
 #include <QMutex>
+#include <QObject>
+#include <QScopedPointer>
+#include <QThread>
+#include <QWaitCondition>
+#include <functional>
 
 class QGraphicsEngine : public QGraphicsItem
 {
     public:
     // Constructors
     QGraphicsEngine(int width, int height);
+    ~QGraphicsEngine() override;
 
     // Getters
     QRectF boundingRect() const override;
     int getWidth() const;
     int getHeight() const;
+    /// Copy of the last published frame
     QImage getQImage() const;
 
     void setRotationX(float rotationX);
     void setRotationY(float rotationY);
     void setRotationZ(float rotationZ);
     void setRotation(float x, float y, float z);
-    QVector<QSharedPointer<QGraphicsEngineDrawable>> getDrawables() { return _drawables; }
+    QVector<QSharedPointer<QGraphicsEngineDrawable>> getDrawables()
+    {
+        QMutexLocker locker(&_drawMutex);
+        return _drawables;
+    }
 
-    QSharedPointer<QTimer> getAnimationTimer() const { return _animationTimer; }
-    void setAnimationTimer(QSharedPointer<QTimer> animationTimer) { _animationTimer = animationTimer; }
+    [[nodiscard]] RenderStats getRenderStats() const
+    {
+        QMutexLocker locker(&_presentMutex);
+        return _renderStats;
+    }
+    [[nodiscard]] bool isAnimating() const
+    {
+        QMutexLocker locker(&_renderMutex);
+        return _animating;
+    }
 
     // Inheritance Methods
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
@@ -38,13 +67,28 @@ class QGraphicsEngine : public QGraphicsItem
     /// Drawing
     void clearDrawables();
     void addDrawable(QSharedPointer<QGraphicsEngineDrawable> &drawable);
+    /// Renders one frame into the back buffer and publishes it, called by the render thread
     void draw();
     /// Light
     void addLightSource(QSharedPointer<LightSource> lightSource);
     void clearLightSources();
-    void autoMoveLightSources();
+    QVector<QSharedPointer<LightSource>> getLightSources()
+    {
+        QMutexLocker locker(&_drawMutex);
+        return _lightSources;
+    }
+    /// Advances the light orbits by fixed 60 Hz simulation steps
+    void autoMoveLightSources(int steps = 1);
+    /// Render thread, frames are paced to GraphicsEngineSettings::targetFps while animating and rendered on request
+    /// otherwise
+    void startRenderThread();
+    void stopRenderThread();
+    /// Wakes the render thread for one frame, safe to call from any thread
+    void requestFrame();
+    /// Queues a change of the settings or the scene for the render thread, which runs it between two frames and
+    /// then renders one. Whatever the GUI changes while the thread runs goes through here, never in place.
+    void post(std::function<void()> change);
     // Animation
-    void setupAnimationTimer();
     void startAnimation();
     void stopAnimation();
     void toggleAnimation();
@@ -53,21 +97,74 @@ class QGraphicsEngine : public QGraphicsItem
     void testPixmap();
 
     private:
+    /// Everything the G-buffer depends on, frames with equal states differ only in their lighting
+    struct SurfaceState
+    {
+        QVector<const QGraphicsEngineDrawable *> drawables;
+        QVector<quint64> versions;
+        QRgb brushColor                     = 0;
+        RasterizationMode rasterizationMode = RasterizationMode::HalfSpaceSimd;
+        ResolveMode resolveMode             = ResolveMode::TileBinned;
+        bool backFaceCulling                = true;
+
+        bool operator==(const SurfaceState &other) const
+        {
+            return drawables == other.drawables && versions == other.versions && brushColor == other.brushColor &&
+                   rasterizationMode == other.rasterizationMode && resolveMode == other.resolveMode &&
+                   backFaceCulling == other.backFaceCulling;
+        }
+    };
+
     // Private Methods
     void rotate(float x, float y, float z);
+    [[nodiscard]] SurfaceState captureSurfaceState(const Settings &settings) const;
+    void applyPendingRotation();
+    void renderLoop();
+    void publishFrame();
 
-    // Private Fields
-    float _rotationX = 0;
-    float _rotationY = 0;
-    float _rotationZ = 0;
+    // Private Fields, the rotation is set from the GUI thread and applied by the next frame
+    float _rotationX      = 0;
+    float _rotationY      = 0;
+    float _rotationZ      = 0;
+    bool _rotationPending = false;
 
     int _width;
     int _height;
-    QImage _qImage;
+    Framebuffer _framebuffer;
+    RenderTargets _renderTargets;
+    GBuffer _gBuffer;
+    // State the G-buffer was filled with, it is reused while nothing but the lights change
+    SurfaceState _surfaceState;
+    bool _gBufferReusable = false;
+    VisibilityBuffer _visibilityBuffer;
+    // Rebuilt every frame in place, so its buffers and exponent tables outlive the frame
+    ShadingContext _shadingContext;
+    RenderStats _renderStats;
     QMutex _drawMutex;
     QVector<QSharedPointer<QGraphicsEngineDrawable>> _drawables;
     QVector<QSharedPointer<LightSource>> _lightSources;
-    QSharedPointer<QTimer> _animationTimer;
+
+    // Presentation, the framebuffer is the back buffer and paint() shows the front image
+    QImage _frontImage;
+    // View-sized target of the upscale when the canvas is scaled down, swapped with the front image
+    QImage _upscaledImage;
+    mutable QMutex _presentMutex;
+    // Lives in the GUI thread, queued repaints die with it
+    QObject _presentContext;
+
+    // Render thread, the flags and the rotation are guarded by the render mutex
+    QScopedPointer<QThread> _renderThread;
+    mutable QMutex _renderMutex;
+    QWaitCondition _renderCondition;
+    bool _frameRequested = false;
+    bool _stopRequested  = false;
+    bool _animating      = true;
+    // Set when a frame is published and cleared when paint() shows it
+    bool _presentPending = false;
+    QVector<std::function<void()>> _pendingChanges;
+    // Used by the render thread only
+    FrameScheduler _frameScheduler;
+    ResolutionScaler _resolutionScaler;
 };
 
 #endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_QGRAPHICSENGINE_H
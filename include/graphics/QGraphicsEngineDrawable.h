@@ -8,12 +8,21 @@
 #include <QImage>
 #include <qmutex.h>
 class DrawData;
+class ShadowMap;
 
 class QGraphicsEngineDrawable
 {
     public:
     virtual void draw(DrawData &drawData)      = 0;
     virtual void transform(QMatrix4x4 &matrix) = 0;
+
+    /// Hands the world-space triangles to the shadow map, drawables that cast no shadow keep the default
+    virtual void castShadow(ShadowMap &) {}
+    /// Changes whenever the geometry handed to castShadow does
+    [[nodiscard]] virtual quint64 getShadowVersion() const { return 0; }
+    /// Changes whenever anything draw() rasterizes does, geometry and materials alike, 0 for a drawable that never
+    /// changes. Frames in which no drawable changed can be re-shaded from the previous frame's G-buffer.
+    [[nodiscard]] virtual quint64 getSurfaceVersion() const { return 0; }
 };
 
 #endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_QGRAPHICSENGINEDRAWABLE_H
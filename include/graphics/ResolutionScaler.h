@@ -0,0 +1,36 @@
+//
+// Created by wookie on 11/30/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_RESOLUTIONSCALER_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_RESOLUTIONSCALER_H
+
+#include "settings/GraphicsEngineSettings.h"
+
+/// Picks the canvas scale for dynamic resolution. Raster and shading cost follow the pixel count, so the scale moves
+/// by the square root of the ratio between the frame time budget and the moving average of the measured frame
+/// time. Scales are multiples of ScaleStep, so small jitter in the frame time does not reallocate the canvas, and
+/// the average starts over after every change because the frames before it were rendered at another size.
+class ResolutionScaler
+{
+    public:
+    static constexpr float ScaleStep = 1.0f / 16.0f;
+
+    // Getters
+    [[maybe_unused]] [[nodiscard]] float getScale() const { return _scale; }
+    [[maybe_unused]] [[nodiscard]] double getAverageFrameTime() const { return _averageFrameTime; }
+
+    // Public Methods
+    /// Feeds the duration of a rendered frame in milliseconds, returns true when the scale changed. With dynamic
+    /// resolution off the scale goes back to 1.
+    bool update(double frameTime, const GraphicsEngineSettings &settings);
+
+    private:
+    float _scale             = 1.0f;
+    double _averageFrameTime = 0.0;
+    int _frameCount          = 0;
+
+    bool setScale(float scale);
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_RESOLUTIONSCALER_H
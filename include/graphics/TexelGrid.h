@@ -0,0 +1,120 @@
+//
+// Created by wookie on 11/25/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_TEXELGRID_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_TEXELGRID_H
+
+#include "settings/ShadingSettings.h"
+#include <QtGlobal>
+#include <cmath>
+
+/// Screen-space derivatives of the texture coordinates. Attributes are interpolated affinely, so the differences
+/// between neighbouring pixels of a quad are the same everywhere on a triangle.
+struct UvGradient
+{
+    float dudx = 0.0f;
+    float dvdx = 0.0f;
+    float dudy = 0.0f;
+    float dvdy = 0.0f;
+};
+
+/// Four texels around a sample point and their bilinear weights, as storage indices
+struct BilinearFootprint
+{
+    int i00, i01, i10, i11;
+    float w00, w01, w10, w11;
+};
+
+/// Dimensions of one mip level and the mapping of its texel coordinates to storage indices in a TextureLayout.
+/// Coordinates are clamped to the edge.
+struct TexelGrid
+{
+    int width  = 0;
+    int height = 0;
+    // Tiled, blocks per row
+    int blocksX = 0;
+    // Morton, bits interleaved from both coordinates before the longer side continues alone
+    int mortonBits  = 0;
+    int storageSize = 0;
+
+    static TexelGrid create(TextureLayout layout, int width, int height);
+    /// log2 of the texel footprint of one pixel on a base level of this size, clamped to [0, maxLod]
+    [[nodiscard]] float computeLod(const UvGradient &gradient, float maxLod) const;
+
+    [[nodiscard]] int index(TextureLayout layout, int x, int y) const;
+
+    template <TextureLayout Layout>
+    [[nodiscard]] int index(int x, int y) const
+    {
+        if constexpr (Layout == TextureLayout::Tiled)
+        {
+            return (((y >> 2) * blocksX + (x >> 2)) << 4) | ((y & 3) << 2) | (x & 3);
+        }
+        else if constexpr (Layout == TextureLayout::Morton)
+        {
+            // The shorter side runs out of bits first, the rest of the longer side's coordinate is stored above
+            const quint32 mask = (1u << mortonBits) - 1;
+            const quint32 low  = spreadBits(x & mask) | (spreadBits(y & mask) << 1);
+            const quint32 high = static_cast<quint32>((x >> mortonBits) | (y >> mortonBits));
+            return static_cast<int>((high << (2 * mortonBits)) | low);
+        }
+        else
+        {
+            return y * width + x;
+        }
+    }
+
+    template <TextureLayout Layout>
+    [[nodiscard]] int nearest(float u, float v) const
+    {
+        const int x = qBound(0, static_cast<int>(u * width), width - 1);
+        const int y = qBound(0, static_cast<int>(v * height), height - 1);
+        return index<Layout>(x, y);
+    }
+
+    template <TextureLayout Layout>
+    [[nodiscard]] BilinearFootprint bilinear(float u, float v) const;
+
+    private:
+    static quint32 spreadBits(quint32 value)
+    {
+        // Moves bit i of a 16-bit value to bit 2i
+        value = (value | (value << 8)) & 0x00FF00FFu;
+        value = (value | (value << 4)) & 0x0F0F0F0Fu;
+        value = (value | (value << 2)) & 0x33333333u;
+        value = (value | (value << 1)) & 0x55555555u;
+        return value;
+    }
+};
+
+template <TextureLayout Layout>
+BilinearFootprint TexelGrid::bilinear(float u, float v) const
+{
+    // Texel centers sit at half-integer coordinates
+    const float x = u * static_cast<float>(width) - 0.5f;
+    const float y = v * static_cast<float>(height) - 0.5f;
+
+    const float xFloor = std::floor(x);
+    const float yFloor = std::floor(y);
+    const float fx     = x - xFloor;
+    const float fy     = y - yFloor;
+
+    const int x0 = qBound(0, static_cast<int>(xFloor), width - 1);
+    const int x1 = qBound(0, static_cast<int>(xFloor) + 1, width - 1);
+    const int y0 = qBound(0, static_cast<int>(yFloor), height - 1);
+    const int y1 = qBound(0, static_cast<int>(yFloor) + 1, height - 1);
+
+    return {
+        index<Layout>(x0, y0),
+        index<Layout>(x1, y0),
+        index<Layout>(x0, y1),
+        index<Layout>(x1, y1),
+        (1.0f - fx) * (1.0f - fy),
+        fx * (1.0f - fy),
+        (1.0f - fx) * fy,
+        fx * fy
+    };
+}
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_TEXELGRID_H
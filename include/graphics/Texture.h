@@ -0,0 +1,63 @@
+//
+// Created by wookie on 11/24/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_TEXTURE_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_TEXTURE_H
+
+#include "graphics/TexelGrid.h"
+#include "settings/ShadingSettings.h"
+#include <QImage>
+#include <QVector>
+
+/// Mip levels selected for the color texture and the normal map of one triangle
+struct SurfaceLod
+{
+    float texture   = 0.0f;
+    float normalMap = 0.0f;
+};
+
+/// Immutable mip-mapped copy of an image in ARGB32, sampled through raw texel arrays.
+/// Coordinates are clamped to the edge; level 0 keeps the original resolution.
+/// Every level is stored in the layout given at construction; the sampler addresses all layouts the same way.
+class Texture
+{
+    public:
+    // Constructors
+    explicit Texture(const QImage &image, TextureLayout layout = TextureLayout::RowMajor);
+
+    // Getters
+    [[maybe_unused]] [[nodiscard]] int getWidth() const { return _levels[0].grid.width; }
+    [[maybe_unused]] [[nodiscard]] int getHeight() const { return _levels[0].grid.height; }
+    [[maybe_unused]] [[nodiscard]] int getLevelCount() const { return _levels.size(); }
+    [[maybe_unused]] [[nodiscard]] TextureLayout getLayout() const { return _layout; }
+
+    // Public Methods
+    /// log2 of the texel footprint of one pixel, clamped to the available levels
+    [[nodiscard]] float computeLod(const UvGradient &gradient) const
+    {
+        return _levels[0].grid.computeLod(gradient, static_cast<float>(_levels.size() - 1));
+    }
+    [[nodiscard]] QRgb sample(float u, float v, float lod, TextureFilter filter) const;
+
+    private:
+    struct MipLevel
+    {
+        TexelGrid grid;
+        QVector<QRgb> texels;
+    };
+
+    TextureLayout _layout;
+    QVector<MipLevel> _levels;
+
+    void buildMipChain();
+    [[nodiscard]] int nearestLevel(float lod) const;
+
+    template <TextureLayout Layout>
+    [[nodiscard]] QRgb sampleLayout(float u, float v, float lod, TextureFilter filter) const;
+    template <TextureLayout Layout>
+    static void sampleBilinear(const MipLevel &level, float u, float v, float *argb);
+    static QRgb packTexel(const float *argb);
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_TEXTURE_H
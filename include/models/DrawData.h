@@ -5,42 +5,65 @@
 #ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_DRAWDATA_H
 #define BEZIERSURFACE_COMPUTERGRAPHICS_2024_DRAWDATA_H
 
+#include "graphics/Framebuffer.h"
 #include "graphics/LightSource.h"
+#include "graphics/NormalMap.h"
+#include "graphics/Texture.h"
+#include "models/GBuffer.h"
+#include "models/HierarchicalZBuffer.h"
+#include "models/RenderStats.h"
+#include "models/RenderTargets.h"
+#include "models/ShadingContext.h"
+#include "models/TileGrid.h"
+#include "models/VisibilityBuffer.h"
 #include <QImage>
 #include <QSharedPointer>
 #include <QVariant>
-#include <qmutex.h>
 
 class DrawData
 {
     public:
-    explicit DrawData(QImage &canvas);
-    DrawData(QImage &canvas, const QColor &brushColor);
-    DrawData(QImage &canvas, const QImage &texture);
+    /// The targets have to match the canvas size and be cleared already, the shading context is built by the caller
+    DrawData(Framebuffer &canvas, RenderTargets &targets, ShadingContext &shadingContext);
+    DrawData(Framebuffer &canvas, RenderTargets &targets, ShadingContext &shadingContext, const QColor &brushColor);
+    DrawData(Framebuffer &canvas, RenderTargets &targets, ShadingContext &shadingContext, const QImage &texture);
 
-    QImage &canvas;
+    Framebuffer &canvas;
 
     QColor brushColor;
-    QSharedPointer<QImage> texture;
-    QSharedPointer<QImage> normalMap;
+    QSharedPointer<Texture> texture;
+    QSharedPointer<NormalMap> normalMap;
 
-    QMutex zBufferMutex;
-    QScopedPointer<float, QScopedPointerArrayDeleter<float>> zBuffer;
-    QVector<QSharedPointer<LightSource>> lightSources;
+    // Borrowed from the render targets
+    float *zBuffer;
+    HierarchicalZBuffer &hiZBuffer;
+    TileGrid &tileGrid;
+    // Borrowed from the engine, which keeps it and its exponent tables across frames
+    ShadingContext &shadingContext;
+    RenderStats stats;
 
-    void initZBuffer();
-    void clearZBuffer() const;
+    // Deferred shading, fragments go to the G-buffer instead of being lit immediately when it is set
+    GBuffer *gBuffer  = nullptr;
+    int materialIndex = -1;
+
+    // Atomic visibility resolve, set instead of using the tile grid
+    VisibilityBuffer *visibilityBuffer = nullptr;
+
+    // Canvas pixels per view pixel, overlays measured in view pixels are scaled by it
+    float resolutionScale = 1.0f;
+
+    /// The z-buffer is row-major, so consecutive pixels of a row are contiguous
+    [[nodiscard]] float &depthAt(int x, int y) const { return zBuffer[y * X + x]; }
+    [[nodiscard]] float *depthRow(int y) const { return zBuffer + y * X; }
 
     void setTexture(const QImage &texture);
+    /// Per-vertex lighting has no per-pixel normal for the normal map to perturb
+    [[nodiscard]] bool usesNormalMap() const { return normalMap && !shadingContext.perVertexLighting; }
+    /// Mip levels of the bound texture and normal map for a triangle with the given UV derivatives
+    [[nodiscard]] SurfaceLod computeSurfaceLod(const UvGradient &gradient) const;
 
     void setBrushColor(const QColor &color);
 
-    void appendLightSource(const LightSource &lightSource)
-    {
-        lightSources.append(QSharedPointer<LightSource>::create(lightSource));
-    }
-    void clearLightSources() { lightSources.clear(); }
-
     private:
     int X, Y;
 };
@@ -0,0 +1,90 @@
+//
+// Created by wookie on 11/18/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_GBUFFER_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_GBUFFER_H
+
+#include "graphics/NormalMap.h"
+#include "graphics/Texture.h"
+#include <QColor>
+#include <QSharedPointer>
+#include <QVector2D>
+#include <QVector3D>
+#include <QVector>
+
+struct GBufferMaterial
+{
+    QSharedPointer<Texture> texture;
+    QSharedPointer<NormalMap> normalMap;
+    QColor brushColor;
+};
+
+/// Per-pixel surface attributes of the nearest fragment, written by the rasterizer and lit by the deferred pass.
+/// Every attribute lives in its own row-major plane; a negative material index marks a pixel without geometry.
+class GBuffer
+{
+    public:
+    // Constructors
+    GBuffer() = default;
+    GBuffer(int width, int height);
+
+    // Getters
+    [[nodiscard]] int getWidth() const { return _width; }
+    [[nodiscard]] int getHeight() const { return _height; }
+    /// Set once an overlay covered a pixel since the last clear, the buffer then no longer describes the surface alone
+    [[nodiscard]] bool hasOverlays() const { return _hasOverlays; }
+
+    [[nodiscard]] int getMaterialIndex(int x, int y) const { return _materialIndices[y * _width + x]; }
+    [[nodiscard]] const GBufferMaterial &getMaterial(int materialIndex) const { return _materials[materialIndex]; }
+    [[nodiscard]] const QVector3D &getPosition(int x, int y) const { return _positions[y * _width + x]; }
+    [[nodiscard]] const QVector3D &getNormal(int x, int y) const { return _normals[y * _width + x]; }
+    [[nodiscard]] const QVector2D &getUv(int x, int y) const { return _uvs[y * _width + x]; }
+    [[nodiscard]] const QVector3D &getUTangent(int x, int y) const { return _uTangents[y * _width + x]; }
+    [[nodiscard]] const QVector3D &getVTangent(int x, int y) const { return _vTangents[y * _width + x]; }
+    [[nodiscard]] const SurfaceLod &getLod(int x, int y) const { return _lods[y * _width + x]; }
+
+    // Public Methods
+    void resize(int width, int height);
+    void clear();
+    int addMaterial(const GBufferMaterial &material);
+
+    void write(
+        int x, int y, int materialIndex, const QVector3D &position, const QVector3D &normal, float u, float v,
+        const QVector3D &uTangent, const QVector3D &vTangent, const SurfaceLod &lod
+    )
+    {
+        const int index         = y * _width + x;
+        _materialIndices[index] = materialIndex;
+        _positions[index]       = position;
+        _normals[index]         = normal;
+        _uvs[index]             = QVector2D(u, v);
+        _uTangents[index]       = uTangent;
+        _vTangents[index]       = vTangent;
+        _lods[index]            = lod;
+    }
+
+    /// Called when an overlay (point, line) covers the pixel, so the shading pass leaves it alone
+    void invalidate(int x, int y)
+    {
+        _materialIndices[y * _width + x] = -1;
+        _hasOverlays                     = true;
+    }
+
+    private:
+    int _width  = 0;
+    int _height = 0;
+
+    bool _hasOverlays = false;
+
+    QVector<int> _materialIndices;
+    QVector<QVector3D> _positions;
+    QVector<QVector3D> _normals;
+    QVector<QVector2D> _uvs;
+    QVector<QVector3D> _uTangents;
+    QVector<QVector3D> _vTangents;
+    QVector<SurfaceLod> _lods;
+    QVector<GBufferMaterial> _materials;
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_GBUFFER_H
@@ -0,0 +1,62 @@
+//
+// Created by wookie on 11/19/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_HIERARCHICALZBUFFER_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_HIERARCHICALZBUFFER_H
+
+#include <QAtomicInteger>
+#include <QRect>
+#include <QVector>
+
+/// Coarse depth bounds kept next to the full resolution z-buffer. Every block stores the farthest (min) and nearest
+/// (max) depth of its pixels; larger z is nearer. A triangle whose nearest depth lies behind the farthest depth of
+/// every block it touches cannot pass a single depth test there and is rejected without per-pixel work.
+/// Blocks must not straddle screen tiles, so the tile size has to be a multiple of the block size.
+/// Rasterizing only marks the blocks it wrote as dirty. Depths only grow, so the stored bounds of a dirty block are
+/// still a conservative test; the block is rescanned only when that test fails, at most once per written batch.
+class HierarchicalZBuffer
+{
+    public:
+    // Constructors
+    HierarchicalZBuffer() = default;
+    HierarchicalZBuffer(int width, int height, int blockSize);
+
+    // Getters
+    [[nodiscard]] int getBlockSize() const { return _blockSize; }
+    /// Bounds as of the last rescan, dirty blocks may have been written since
+    [[nodiscard]] float getMinDepth(int blockX, int blockY) const { return _minDepths[blockY * _blocksX + blockX]; }
+    [[nodiscard]] float getMaxDepth(int blockX, int blockY) const { return _maxDepths[blockY * _blocksX + blockX]; }
+    [[nodiscard]] qint64 getTestedCount() const { return _testedCount.loadRelaxed(); }
+    [[nodiscard]] qint64 getRejectedCount() const { return _rejectedCount.loadRelaxed(); }
+
+    // Public Methods
+    void resize(int width, int height, int blockSize);
+    void clear();
+
+    /// rect must lie inside the canvas, dirty blocks the stale bounds cannot reject are rescanned from zBuffer
+    [[nodiscard]] bool isOccluded(const float *zBuffer, const QRect &rect, float nearestDepth);
+    /// Callers count their tests locally and add them once, so the workers do not contend for the counters
+    void addCounts(qint64 tested, qint64 rejected);
+    /// Marks every block overlapping rect as written
+    void invalidate(const QRect &rect);
+
+    private:
+    // Private Methods
+    void refreshBlock(const float *zBuffer, int blockX, int blockY);
+
+    int _width     = 0;
+    int _height    = 0;
+    int _blockSize = 0;
+    int _blocksX   = 0;
+    int _blocksY   = 0;
+    QVector<float> _minDepths;
+    QVector<float> _maxDepths;
+    // Blocks written since their bounds were last computed
+    QVector<quint8> _dirty;
+
+    QAtomicInteger<qint64> _testedCount   = 0;
+    QAtomicInteger<qint64> _rejectedCount = 0;
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_HIERARCHICALZBUFFER_H
@@ -0,0 +1,49 @@
+//
+// Created by wookie on 11/27/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_LIGHTGRID_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_LIGHTGRID_H
+
+#include <QRect>
+#include <QVector>
+
+/// Per-tile light lists of one frame. Every light is binned into the screen tiles its bounds overlap, so a pixel
+/// evaluates only the lights that can reach it. Lists are stored back to back, indexed by one offset per tile.
+class LightGrid
+{
+    public:
+    // Getters
+    [[nodiscard]] bool isEmpty() const { return _tileOffsets.isEmpty(); }
+    [[maybe_unused]] [[nodiscard]] int getTileSize() const { return _tileSize; }
+    /// Sum of the list lengths over all tiles
+    [[nodiscard]] int getEntryCount() const { return _lightIndices.size(); }
+    [[nodiscard]] bool contains(int x, int y) const { return x >= 0 && y >= 0 && x < _width && y < _height; }
+
+    /// Lights of the tile under the pixel, which has to be inside the grid
+    [[nodiscard]] const int *getTileLights(int x, int y, int &count) const
+    {
+        const int tile = (y / _tileSize) * _tilesX + x / _tileSize;
+        count          = _tileOffsets[tile + 1] - _tileOffsets[tile];
+        return _lightIndices.constData() + _tileOffsets[tile];
+    }
+
+    // Public Methods
+    /// Bounds are in pixels, one per light, lights with empty bounds reach no tile
+    void build(const QVector<QRect> &lightBounds, int width, int height, int tileSize);
+    void clear();
+
+    private:
+    int _width    = 0;
+    int _height   = 0;
+    int _tileSize = 0;
+    int _tilesX   = 0;
+    int _tilesY   = 0;
+    // One more than there are tiles, the list of tile i spans [offsets[i], offsets[i + 1])
+    QVector<int> _tileOffsets;
+    QVector<int> _lightIndices;
+
+    template <typename Function> void forEachTile(const QRect &bounds, Function function) const;
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_LIGHTGRID_H
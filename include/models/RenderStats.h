@@ -0,0 +1,44 @@
+//
+// Created by wookie on 11/19/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_RENDERSTATS_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_RENDERSTATS_H
+
+#include <QtGlobal>
+
+/// Counters of the last finished frame
+struct RenderStats
+{
+    // Primitive assembly
+    qint64 trianglesSubmitted = 0;
+    qint64 backFacesCulled    = 0;
+    qint64 viewportRejected   = 0;
+    qint64 guardBandClipped   = 0;
+
+    // Hierarchical Z, one test per triangle and screen tile it overlaps
+    qint64 hiZTested   = 0;
+    qint64 hiZRejected = 0;
+
+    // Lights summed over the per-tile light lists, the lights times the tiles without culling
+    qint64 lightTileEntries = 0;
+
+    // Re-shaded from the cached G-buffer, nothing was rasterized and the counters above stay 0
+    bool relit = false;
+
+    // Shadow maps rendered again because their light or a caster moved, the others were reused
+    qint64 shadowMapsRendered = 0;
+
+    // Frame pacing, times are in milliseconds and the average is a moving one
+    double frameTime        = 0.0;
+    double averageFrameTime = 0.0;
+    // Fixed 60 Hz animation steps run before the frame, 0 while the animation is paused
+    int simulationSteps = 0;
+    // Published frames replaced before the GUI painted them, since the render thread started
+    qint64 framesSkipped = 0;
+
+    // Canvas size relative to the view, below 1 while dynamic resolution scales it down
+    float resolutionScale = 1.0f;
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_RENDERSTATS_H
@@ -0,0 +1,44 @@
+//
+// Created by wookie on 11/28/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_RENDERTARGETS_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_RENDERTARGETS_H
+
+#include "models/HierarchicalZBuffer.h"
+#include "models/TileGrid.h"
+#include <QVector>
+
+/// Depth targets and screen tiles owned by the engine, kept from frame to frame. They are rebuilt only when the
+/// canvas size, tile size or hierarchical Z block size change. The depth buffer keeps its capacity when the canvas
+/// shrinks, so switching between resolutions reuses one allocation instead of returning it to the heap.
+class RenderTargets
+{
+    public:
+    // Getters
+    [[nodiscard]] int getWidth() const { return _width; }
+    [[nodiscard]] int getHeight() const { return _height; }
+    [[nodiscard]] float *getDepth() { return _depth; }
+    [[nodiscard]] HierarchicalZBuffer &getHiZBuffer() { return _hiZBuffer; }
+    [[nodiscard]] TileGrid &getTileGrid() { return _tileGrid; }
+
+    // Public Methods
+    /// Returns true when the targets had to be rebuilt
+    bool resize(int width, int height, int tileSize, int hiZBlockSize);
+    /// Resets depth to the farthest value in one parallel pass, and the hierarchical Z with it
+    void clear();
+
+    private:
+    int _width        = 0;
+    int _height       = 0;
+    int _tileSize     = 0;
+    int _hiZBlockSize = 0;
+
+    // Never shared, so the pointer taken on resize stays valid and writes never detach
+    QVector<float> _depthStorage;
+    float *_depth = nullptr;
+    HierarchicalZBuffer _hiZBuffer;
+    TileGrid _tileGrid;
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_RENDERTARGETS_H
@@ -0,0 +1,93 @@
+//
+// Created by wookie on 11/23/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_SHADINGCONTEXT_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_SHADINGCONTEXT_H
+
+#include "graphics/LightSource.h"
+#include "models/LightGrid.h"
+#include "settings/LightSettings.h"
+#include "settings/ShadingSettings.h"
+#include "utils/PowerUtils.h"
+#include <QSharedPointer>
+#include <QVector3D>
+#include <QVector>
+
+/// Lighting inputs of one frame, resolved once before drawing and only read by the shading loops.
+/// Lights are stored as structure-of-arrays, one float array per component. The engine rebuilds one context every
+/// frame, so the exponent tables are recomputed only when an exponent or the table size changes.
+class ShadingContext
+{
+    public:
+    // Getters
+    [[nodiscard]] int getLightCount() const { return _lightCount; }
+    [[nodiscard]] bool isLit() const { return _lightCount > 0; }
+    [[nodiscard]] const LightGrid &getLightGrid() const { return _lightGrid; }
+
+    // Public Methods
+    /// With lit set to false the context holds no lights and surfaces keep their base color.
+    /// The canvas size is needed to bin the lights into screen tiles.
+    void build(
+        const QVector<QSharedPointer<LightSource>> &lightSources, const LightSettings &lightSettings,
+        const ShadingSettings &shadingSettings, bool lit, int width, int height
+    );
+
+    /// cos^m of the angle between the viewer and the reflected light, cosVR in [0, 1]
+    [[nodiscard]] float specular(float cosVR) const
+    {
+        return _useSpecularTable ? _specularTable.evaluate(cosVR) : PowerUtils::powInt(cosVR, m);
+    }
+    /// Reflector cone falloff, cosLD in [0, 1]
+    [[nodiscard]] float reflector(float cosLD) const
+    {
+        return _useReflectorTable ? _reflectorTable.evaluate(cosLD) : PowerUtils::powInt(cosLD, mCoeffReflector);
+    }
+    /// Light reaching a surface point summed over all lights, per channel and before modulation by the surface color
+    [[nodiscard]] QVector3D irradiance(const QVector3D &position, const QVector3D &normal) const;
+    /// Same, but only over the lights binned into the tile under pixel (x, y), every light outside the canvas
+    [[nodiscard]] QVector3D irradiance(const QVector3D &position, const QVector3D &normal, int x, int y) const;
+
+    // Material and light coefficients
+    float kd              = 0.0f;
+    float ks              = 0.0f;
+    int m                 = 0;
+    bool reflectorEnabled = false;
+    int mCoeffReflector   = 0;
+
+    TextureFilter textureFilter = TextureFilter::Trilinear;
+    // Lighting is evaluated at the vertices and interpolated, set only when the context is lit
+    bool perVertexLighting = false;
+
+    // Lights
+    QVector<float> positionsX;
+    QVector<float> positionsY;
+    QVector<float> positionsZ;
+    QVector<float> directionsX;
+    QVector<float> directionsY;
+    QVector<float> directionsZ;
+    QVector<float> colorsR;
+    QVector<float> colorsG;
+    QVector<float> colorsB;
+    // 0 for lights without a falloff
+    QVector<float> radii;
+    // One per light when shadows are enabled, empty otherwise
+    QVector<const ShadowMap *> shadowMaps;
+
+    private:
+    int _lightCount = 0;
+
+    bool _useSpecularTable  = false;
+    bool _useReflectorTable = false;
+    PowerTable _specularTable;
+    PowerTable _reflectorTable;
+    LightGrid _lightGrid;
+
+    void addLight(int i, const QVector3D &position, const QVector3D &normal, float &r, float &g, float &b) const;
+    /// Pixel rectangle that holds every point the light can reach, the whole canvas for lights without a radius
+    [[nodiscard]] QRect lightBounds(int i, int width, int height) const;
+
+    static bool useTable(const ShadingSettings &settings, int exponent);
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_SHADINGCONTEXT_H
@@ -0,0 +1,77 @@
+//
+// Created by wookie on 11/26/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_SHADOWMAP_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_SHADOWMAP_H
+
+#include "settings/ShadingSettings.h"
+#include <QSharedPointer>
+#include <QVector3D>
+#include <QVector>
+#include <array>
+
+class QGraphicsEngineDrawable;
+
+/// Depth of the nearest caster as seen from one light, through a perspective frustum along the light direction that
+/// is fitted around every caster. Texels store the inverse view distance, which interpolates exactly in screen space;
+/// larger is nearer and 0 means no caster.
+/// The map remembers the light and the geometry version of every caster it was rendered from and is re-rendered only
+/// when one of them changes.
+class ShadowMap
+{
+    public:
+    // Getters
+    [[maybe_unused]] [[nodiscard]] int getSize() const { return _size; }
+
+    // Public Methods
+    /// Returns true when the map had to be rendered again
+    bool update(
+        const QVector3D &lightPosition, const QVector3D &lightDirection,
+        const QVector<QSharedPointer<QGraphicsEngineDrawable>> &casters, const ShadingSettings &settings
+    );
+    /// Called back by the casters from QGraphicsEngineDrawable::castShadow, positions are in world space
+    void addCaster(const QVector<QVector3D> &positions, const QVector<quint32> &indices);
+
+    /// Fraction of the PCF kernel around the position that sees the light, 1 outside the map
+    [[nodiscard]] float visibility(const QVector3D &position) const;
+
+    private:
+    struct Caster
+    {
+        QVector<QVector3D> positions;
+        QVector<quint32> indices;
+        // Shadow map x, y and inverse view distance, filled while rendering
+        QVector<QVector3D> projected;
+    };
+
+    struct CasterVersion
+    {
+        const QGraphicsEngineDrawable *caster;
+        quint64 version;
+
+        bool operator==(const CasterVersion &other) const
+        {
+            return caster == other.caster && version == other.version;
+        }
+    };
+
+    int _size      = 0;
+    int _pcfRadius = 0;
+    float _bias    = 0.0f;
+    QVector3D _lightPosition;
+    QVector3D _lightDirection;
+    QVector<CasterVersion> _versions;
+
+    // Row-major view-projection rows for x, y and w
+    std::array<float, 12> _lightMatrix{};
+    QVector<float> _depth;
+    // Only alive while rendering
+    QVector<Caster> _casters;
+
+    void render();
+    void fitFrustum();
+    void rasterizeRows(const Caster &caster, int minY, int maxY);
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_SHADOWMAP_H
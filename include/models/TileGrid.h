@@ -0,0 +1,47 @@
+//
+// Created by wookie on 11/16/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_TILEGRID_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_TILEGRID_H
+
+#include <QRect>
+#include <QVector>
+
+struct Tile
+{
+    QRect rect;
+    QVector<int> triangleIndices;
+};
+
+/// Splits the canvas into fixed-size screen tiles and keeps, for every tile, the list of triangles overlapping it.
+/// Each tile is rasterized by exactly one worker, so depth testing and pixel writes inside a tile never race.
+class TileGrid
+{
+    public:
+    // Constructors
+    TileGrid() = default;
+    TileGrid(int width, int height, int tileSize);
+
+    // Getters
+    [[nodiscard]] QVector<Tile> &getTiles() { return _tiles; }
+    [[nodiscard]] const QVector<Tile> &getTiles() const { return _tiles; }
+    [[maybe_unused]] [[nodiscard]] int getTileSize() const { return _tileSize; }
+    [[maybe_unused]] [[nodiscard]] int getTilesX() const { return _tilesX; }
+    [[maybe_unused]] [[nodiscard]] int getTilesY() const { return _tilesY; }
+
+    // Public Methods
+    void resize(int width, int height, int tileSize);
+    void clearBins();
+    void binTriangle(int triangleIndex, const QRect &bounds);
+
+    private:
+    int _width    = 0;
+    int _height   = 0;
+    int _tileSize = 0;
+    int _tilesX   = 0;
+    int _tilesY   = 0;
+    QVector<Tile> _tiles;
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_TILEGRID_H
@@ -0,0 +1,71 @@
+//
+// Created by wookie on 11/22/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_VISIBILITYBUFFER_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_VISIBILITYBUFFER_H
+
+#include <QAtomicInteger>
+#include <QScopedPointer>
+#include <QtGlobal>
+#include <cstring>
+
+/// One 64-bit word per pixel, the fragment depth in the high half and the primitive ID in the low half.
+/// Any number of threads may rasterize into it at once: the larger word wins through compare-and-swap, which keeps
+/// the nearest fragment (larger z is nearer) and, on equal depth, the higher primitive ID. The result therefore
+/// does not depend on the thread schedule.
+class VisibilityBuffer
+{
+    public:
+    using Word                 = quint64;
+    static constexpr Word Empty = 0;
+
+    // Constructors
+    VisibilityBuffer() = default;
+    VisibilityBuffer(int width, int height);
+
+    // Getters
+    [[nodiscard]] int getWidth() const { return _width; }
+    [[nodiscard]] int getHeight() const { return _height; }
+
+    // Public Methods
+    void resize(int width, int height);
+
+    void testAndSet(int x, int y, Word word)
+    {
+        QAtomicInteger<Word> &pixel = _words.data()[y * _width + x];
+
+        Word current = pixel.loadRelaxed();
+        while (word > current && !pixel.testAndSetRelaxed(current, word, current))
+        {
+        }
+    }
+
+    /// Returns the word of a pixel and resets it to Empty, so the buffer is clean for the next mesh
+    Word take(int x, int y)
+    {
+        QAtomicInteger<Word> &pixel = _words.data()[y * _width + x];
+
+        const Word word = pixel.loadRelaxed();
+        if (word != Empty)
+            pixel.storeRelaxed(Empty);
+        return word;
+    }
+
+    /// The depth is stored losslessly, its bits are remapped so unsigned order matches float order
+    static Word pack(float depth, quint32 primitiveId)
+    {
+        quint32 bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        bits = (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+        return static_cast<Word>(bits) << 32 | primitiveId;
+    }
+    static quint32 unpackPrimitiveId(Word word) { return static_cast<quint32>(word); }
+
+    private:
+    int _width  = 0;
+    int _height = 0;
+    QScopedPointer<QAtomicInteger<Word>, QScopedPointerArrayDeleter<QAtomicInteger<Word>>> _words;
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_VISIBILITYBUFFER_H
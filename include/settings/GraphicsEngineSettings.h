@@ -7,12 +7,30 @@
 
 #include <QColor>
 
+enum class UpscaleFilter
+{
+    // Four nearest canvas pixels weighted by distance
+    Bilinear,
+    // Bilinear, but pixels far from the nearest one in luminance lose weight, so silhouettes do not smear
+    EdgeAware
+};
+
 class GraphicsEngineSettings
 {
     public:
     int sizeX              = 700;
     int sizeY              = 700;
     QColor backgroundColor = Qt::white;
+    // Frames per second the render thread is paced to, 0 renders as fast as the pipeline allows
+    int targetFps = 60;
+
+    // Dynamic resolution, the canvas is rendered at a scale of the view that follows the moving average of the
+    // frame time, in milliseconds, against the budget and is upscaled for presenting
+    bool dynamicResolution      = false;
+    float frameTimeBudget       = 16.0f;
+    float minResolutionScale    = 0.5f;
+    float maxResolutionScale    = 1.0f;
+    UpscaleFilter upscaleFilter = UpscaleFilter::EdgeAware;
 };
 
 #endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_GRAPHICSENGINESETTINGS_H
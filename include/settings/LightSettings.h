@@ -24,6 +24,12 @@ class LightSettings
     QVector3D orbitCenter     = QVector3D(0.5, 0.5, 0.5);
     QVector3D centerToPointAt = QVector3D(0.5, 0.5, 0);
 
+    // Influence radius of the orbiting lights in scene units, 0 lets them reach everything
+    float lightRadius = 0.75f;
+    // Static lights scattered over the scene in front of the models, for scenes with many small lights
+    int smallLightCount    = 0;
+    float smallLightRadius = 0.15f;
+
     // Reflector Settings
     int mCoeffReflector = 8;
 
@@ -0,0 +1,68 @@
+//
+// Created by wookie on 11/16/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_RASTERIZERSETTINGS_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_RASTERIZERSETTINGS_H
+
+enum class RasterizationMode
+{
+    Scanline,
+    HalfSpace,
+    // Half-space traversal with the four-wide PixelQuadKernel (SSE2 with a bit-identical scalar fallback)
+    HalfSpaceSimd
+};
+
+enum class ResolveMode
+{
+    // Triangles are binned into screen tiles and every tile is rasterized and shaded by one worker
+    TileBinned,
+    // Triangles are rasterized concurrently into a VisibilityBuffer, the surviving fragments are shaded afterwards
+    AtomicVisibility
+};
+
+enum class Multisampling
+{
+    Off,
+    // Coverage and depth per sample, shading once per pixel and triangle
+    X4,
+    X8
+};
+
+class RasterizerSettings
+{
+    public:
+    // Triangle setup
+    RasterizationMode rasterizationMode = RasterizationMode::HalfSpaceSimd;
+    ResolveMode resolveMode             = ResolveMode::TileBinned;
+
+    // Primitive assembly, meshes marked two-sided are never back-face culled
+    bool backFaceCulling = true;
+    // Pixels past each canvas edge inside which triangles are only scissored, larger ones get clipped
+    int guardBand = 1024;
+
+    // Binning
+    int tileSize = 64;
+
+    // Hierarchical Z, tileSize has to be a multiple of hiZBlockSize
+    bool hierarchicalZ = true;
+    int hiZBlockSize   = 8;
+
+    // Anti-aliasing, multisampled frames always rasterize tile-binned and shade forward
+    Multisampling multisampling = Multisampling::Off;
+
+    [[nodiscard]] int sampleCount() const
+    {
+        switch (multisampling)
+        {
+        case Multisampling::X4:
+            return 4;
+        case Multisampling::X8:
+            return 8;
+        default:
+            return 1;
+        }
+    }
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_RASTERIZERSETTINGS_H
@@ -9,6 +9,8 @@
 #include "GraphicsEngineSettings.h"
 #include "LightSettings.h"
 #include "MeshSettings.h"
+#include "RasterizerSettings.h"
+#include "ShadingSettings.h"
 #include "TriangleSettings.h"
 #include "VertexSettings.h"
 #include <QColor>
@@ -28,6 +30,8 @@ class Settings
     VertexSettings vertexSettings;
     LightSettings lightSettings;
     BezierSurfaceSettings bezierSurfaceSettings;
+    RasterizerSettings rasterizerSettings;
+    ShadingSettings shadingSettings;
 
     private:
     Settings()                       = default;
@@ -0,0 +1,70 @@
+//
+// Created by wookie on 11/18/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_SHADINGSETTINGS_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_SHADINGSETTINGS_H
+
+enum class TextureFilter
+{
+    // Closest texel of the closest mip level
+    Nearest,
+    // Four texels of the closest mip level
+    Bilinear,
+    // Bilinear samples of the two nearest mip levels blended by the fractional LOD
+    Trilinear
+};
+
+enum class TextureLayout
+{
+    RowMajor,
+    // 4x4 blocks of 64 bytes, one cache line each, stored row by row
+    Tiled,
+    // Z-order over the texture padded to power-of-two sides
+    Morton
+};
+
+enum class ShadingRate
+{
+    // Phong, the lighting model runs for every pixel
+    PerPixel,
+    // Gouraud, the lighting model runs for every vertex and the light is interpolated, textures stay per pixel
+    PerVertex,
+    // Per vertex on machines with few hardware threads, per pixel otherwise
+    Automatic
+};
+
+class ShadingSettings
+{
+    public:
+    // Pipeline
+    bool deferredShading    = false;
+    ShadingRate shadingRate = ShadingRate::Automatic;
+    // Automatic shading rate, machines with at most this many hardware threads light per vertex
+    int perVertexThreadThreshold = 4;
+    // Frames in which only the lights changed are re-shaded from the last G-buffer instead of being rasterized
+    bool incrementalRelighting = true;
+
+    // Textures and normal maps
+    TextureFilter textureFilter = TextureFilter::Trilinear;
+    // Applied when a texture is loaded, bench/TextureLayoutBench compares the layouts
+    TextureLayout textureLayout = TextureLayout::RowMajor;
+
+    // Tiled light culling, lights with a radius are evaluated only in the screen tiles they can reach
+    bool lightCulling = true;
+    int lightTileSize = 16;
+
+    // Shadow maps, one per light, the bias is in world units along the light ray
+    bool shadows        = false;
+    int shadowMapSize   = 1024;
+    int shadowPcfRadius = 1;
+    float shadowBias    = 0.01f;
+
+    // Specular and reflector exponents, from the threshold up an interpolated table replaces repeated squaring
+    // as long as its error bound stays under half an 8-bit color step
+    bool exponentLookupTable   = false;
+    int exponentTableThreshold = 16;
+    int exponentTableSize      = 1024;
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_SHADINGSETTINGS_H
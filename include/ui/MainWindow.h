@@ -29,7 +29,9 @@ class MainWindow : public QMainWindow
         QSlider *&yRotationSlider, QSlider *&zRotationSlider
     ) const;
 
-    void setupBezierSurfaceBox(const QWidget *centralWidget, QVBoxLayout *leftToolbarLayout) const;
+    void setupBezierSurfaceBox(
+        const QWidget *centralWidget, QGraphicsEngine *engine, QVBoxLayout *leftToolbarLayout
+    ) const;
 
     void setupMiscBox(
         QWidget *centralWidget, QGraphicsEngine *engine, QSharedPointer<BezierSurface> &bezierSurface,
@@ -37,6 +39,9 @@ class MainWindow : public QMainWindow
         const QSlider *yRotationSlider, const QSlider *zRotationSlider
     ) const;
 
-    void setupLightningBox(const QWidget *centralWidget, QVBoxLayout *leftToolbarLayout) const;
+    void setupLightningBox(const QWidget *centralWidget, QGraphicsEngine *engine, QVBoxLayout *leftToolbarLayout) const;
+
+    /// Status bar labels refreshed from the counters and frame times of the last rendered frame
+    void setupStatsBar(QGraphicsEngine *engine);
 };
 #endif // MAINWINDOW_H
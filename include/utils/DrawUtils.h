@@ -14,13 +14,29 @@ class DrawUtils
         DrawData &drawData, const QVector3D &start, const QVector3D &end, const QColor &color = Qt::black,
         float width = 1.0f
     );
+    /// Without writeDepth the point is depth tested only, so markers drawn last do not end up in the depth buffer
+    /// that relit frames keep
     static void drawPoint(
         DrawData &drawData, const QVector3D &point, const QColor &color = Qt::black, int radiusX = 1.0f,
-        int radiusY = 1.0f
+        int radiusY = 1.0f, bool writeDepth = true
     );
 
     static void
-    drawPixel(DrawData &drawData, const QVector3D &position3d, const QVector3D &normal, QColor &color, int x, int y);
+    drawPixel(DrawData &drawData, const QVector3D &position3d, const QVector3D &normal, QRgb color, int x, int y);
+    /// Writes the surface color modulated by light already summed at this pixel, e.g. interpolated from the vertices
+    static void drawLitPixel(DrawData &drawData, const QVector3D &irradiance, QRgb color, int x, int y);
+
+    static QRgb sampleColor(
+        const QSharedPointer<Texture> &texture, QRgb brushColor, float u, float v, float lod, TextureFilter filter
+    );
+    /// Replaces normal by the mapped normal, transformed from tangent space by the interpolated tangent frame
+    static void sampleNormalMap(
+        const NormalMap &normalMap, float u, float v, float lod, TextureFilter filter, QVector3D &normal,
+        const QVector3D &uTangent, const QVector3D &vTangent
+    );
+
+    /// Deferred shading pass, lights every pixel stored in drawData.gBuffer exactly once
+    static void shadeGBuffer(DrawData &drawData);
 };
 
 #endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_DRAWUTILS_H
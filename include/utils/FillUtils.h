@@ -0,0 +1,19 @@
+//
+// Created by wookie on 11/28/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_FILLUTILS_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_FILLUTILS_H
+
+#include <QtGlobal>
+
+class FillUtils
+{
+    public:
+    /// Sets count floats to value, split into contiguous chunks that the workers fill four floats per store
+    static void parallelFill(float *data, qsizetype count, float value);
+    /// Sequential fill of one chunk, SSE2 with a scalar head and tail
+    static void fill(float *data, qsizetype count, float value);
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_FILLUTILS_H
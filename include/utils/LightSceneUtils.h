@@ -0,0 +1,20 @@
+//
+// Created by wookie on 12/1/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_LIGHTSCENEUTILS_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_LIGHTSCENEUTILS_H
+
+#include "graphics/LightSource.h"
+#include <QSharedPointer>
+#include <QVector>
+
+class LightSceneUtils
+{
+    public:
+    /// Static lights on a square grid over the unit canvas at depth z, pointing into the scene. Colors run around
+    /// the hue circle, so neighbouring lights are told apart.
+    static QVector<QSharedPointer<LightSource>> createSmallLights(int count, float radius, float z);
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_LIGHTSCENEUTILS_H
@@ -0,0 +1,19 @@
+//
+// Created by wookie on 11/30/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_UPSCALEUTILS_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_UPSCALEUTILS_H
+
+#include "settings/GraphicsEngineSettings.h"
+#include <QImage>
+
+class UpscaleUtils
+{
+    public:
+    /// Resamples an opaque ARGB32 image into the whole of target, which keeps its size and format. Pixel centers
+    /// are aligned, so the borders of both images coincide. Rows are filtered in parallel.
+    static void upscale(const QImage &source, QImage &target, UpscaleFilter filter);
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_UPSCALEUTILS_H
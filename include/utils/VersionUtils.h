@@ -0,0 +1,23 @@
+//
+// Created by wookie on 11/29/24.
+//
+
+#ifndef BEZIERSURFACE_COMPUTERGRAPHICS_2024_VERSIONUTILS_H
+#define BEZIERSURFACE_COMPUTERGRAPHICS_2024_VERSIONUTILS_H
+
+#include <QtGlobal>
+#include <atomic>
+
+class VersionUtils
+{
+    public:
+    /// Process-wide increasing counter, never 0. A newer version is larger than every older one, so the maximum of
+    /// several versions changes whenever any of them does.
+    static quint64 next()
+    {
+        static std::atomic<quint64> counter{0};
+        return ++counter;
+    }
+};
+
+#endif // BEZIERSURFACE_COMPUTERGRAPHICS_2024_VERSIONUTILS_H
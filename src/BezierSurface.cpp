@@ -14,9 +14,11 @@ BezierSurface::BezierSurface(const QString &filename, int tessellationLevel) : M
         tessellationLevel = Settings::getInstance().meshSettings.tessellationLevel;
     }
     Q_ASSERT(tessellationLevel >= 0);
+    // The tessellation alternates winding between the two triangles of a quad, and the patch is open anyway
+    _twoSided = true;
     readControlPoints(filename);
 
-    _triangles = create2dTessellationTriangles(tessellationLevel);
+    create2dTessellationGrid(tessellationLevel, _vertices, _indices);
     map3dBezierFrom2dMesh();
 }
 
@@ -79,18 +81,16 @@ void BezierSurface::map3dBezierFrom2dMesh()
     float minY = std::numeric_limits<float>::max();
     float maxX = std::numeric_limits<float>::min();
     float maxY = std::numeric_limits<float>::min();
-    for (auto &triangle : _triangles)
+    // Every grid point is evaluated once, no matter how many triangles share it
+    for (int i = 0; i < _vertices.size(); i++)
     {
-        for (int i = 0; i < 3; i++)
-        {
-            Vertex &vertex = triangle[i];
-            evaluateBezierSurface(vertex);
+        evaluateBezierSurface(i);
 
-            minX = std::min(minX, vertex.getPositionOriginal().x());
-            minY = std::min(minY, vertex.getPositionOriginal().y());
-            maxX = std::max(maxX, vertex.getPositionOriginal().x());
-            maxY = std::max(maxY, vertex.getPositionOriginal().y());
-        }
+        const QVector3D &position = _vertices.getPositions()[i];
+        minX                      = std::min(minX, position.x());
+        minY                      = std::min(minY, position.y());
+        maxX                      = std::max(maxX, position.x());
+        maxY                      = std::max(maxY, position.y());
     }
     qDebug() << "Bounding box:" << minX << minY << maxX << maxY;
 
@@ -104,40 +104,39 @@ void BezierSurface::map3dBezierFrom2dMesh()
 
     qDebug() << "Centering and scaling mesh to:" << lowerBound << "-" << upperBound;
 
-    QVector3D center3D;
-    for (auto &triangle : _triangles)
+    for (int i = 0; i < _vertices.size(); i++)
     {
-        for (int i = 0; i < 3; i++)
-        {
-            Vertex &vertex = triangle[i];
+        QVector3D originalPosition = _vertices.getPositions()[i];
+        QVector3D scaledPosition   = (originalPosition - QVector3D(minX, minY, 0)) * QVector3D(scaleX, scaleY, 1) +
+                                   QVector3D(offset, offset, 0);
+        _vertices.setPosition(i, scaledPosition);
 
-            QVector3D originalPosition = vertex.getPositionOriginal();
-            QVector3D scaledPosition   = (originalPosition - QVector3D(minX, minY, 0)) * QVector3D(scaleX, scaleY, 1) +
-                                       QVector3D(offset, offset, 0);
-            vertex.setPositionOriginal(scaledPosition);
-            center3D += scaledPosition;
+        QVector3D uTangent = _vertices.getUTangents()[i].normalized() * QVector3D(scaleX, scaleX, scaleX);
+        QVector3D vTangent = _vertices.getVTangents()[i].normalized() * QVector3D(scaleY, scaleY, scaleY);
 
-            QVector3D uTangent = vertex.getUTangentOriginal().normalized() * QVector3D(scaleX, scaleX, scaleX);
-            QVector3D vTangent = vertex.getVTangentOriginal().normalized() * QVector3D(scaleY, scaleY, scaleY);
+        QVector3D normal = QVector3D::crossProduct(uTangent, vTangent);
 
-            QVector3D normal = QVector3D::crossProduct(uTangent, vTangent);
+        _vertices.setUTangent(i, uTangent.normalized());
+        _vertices.setVTangent(i, vTangent.normalized());
+        _vertices.setNormal(i, normal.normalized());
+    }
 
-            vertex.setUTangentOriginal(uTangent.normalized());
-            vertex.setVTangentOriginal(vTangent.normalized());
-            vertex.setNormalOriginal(normal.normalized());
-        }
+    // Averaged over triangle corners, so shared grid points count once per triangle
+    QVector3D center3D;
+    for (const quint32 index : _indices)
+    {
+        center3D += _vertices.getPositions()[index];
     }
-    center3D /= _triangles.size() * 3;
+    center3D /= _indices.size();
     _position = QVector3D(0.5, 0.5, center3D.z());
     qDebug() << "Center:" << center3D;
 }
 
-void BezierSurface::evaluateBezierSurface(Vertex &vertex) const
+void BezierSurface::evaluateBezierSurface(int vertexIndex)
 {
-    float u = vertex.getPositionOriginal().x();
-    float v = vertex.getPositionOriginal().y();
-    vertex.setU(u);
-    vertex.setV(v);
+    float u = _vertices.getPositions()[vertexIndex].x();
+    float v = _vertices.getPositions()[vertexIndex].y();
+    _vertices.setUv(vertexIndex, u, v);
 
     QVector3D position(0, 0, 0);
     QVector3D uTangent(0, 0, 0);
@@ -164,10 +163,10 @@ void BezierSurface::evaluateBezierSurface(Vertex &vertex) const
 
     QVector3D normal = QVector3D::crossProduct(uTangent, vTangent).normalized();
 
-    vertex.setPositionOriginal(position);
-    vertex.setUTangentOriginal(uTangent);
-    vertex.setVTangentOriginal(vTangent);
-    vertex.setNormalOriginal(normal);
+    _vertices.setPosition(vertexIndex, position);
+    _vertices.setUTangent(vertexIndex, uTangent);
+    _vertices.setVTangent(vertexIndex, vTangent);
+    _vertices.setNormal(vertexIndex, normal);
 }
 
 void BezierSurface::draw(DrawData &drawData)
@@ -222,7 +221,7 @@ void BezierSurface::transform(QMatrix4x4 &matrix)
 void BezierSurface::setTessellationLevel(int tessellationLevel)
 {
     QMutexLocker locker(&_mutex);
-    _triangles = create2dTessellationTriangles(tessellationLevel);
+    create2dTessellationGrid(tessellationLevel, _vertices, _indices);
     map3dBezierFrom2dMesh();
     for (int i = 0; i < _controlPointsNormal.size(); ++i)
     {
@@ -3,52 +3,51 @@
 //
 
 #include "models/DrawData.h"
+#include "settings/Settings.h"
 
-DrawData::DrawData(QImage &canvas) : canvas(canvas)
+DrawData::DrawData(Framebuffer &canvas, RenderTargets &targets, ShadingContext &shadingContext)
+    : canvas(canvas), zBuffer(targets.getDepth()), hiZBuffer(targets.getHiZBuffer()), tileGrid(targets.getTileGrid()),
+      shadingContext(shadingContext)
 {
+    Q_ASSERT(targets.getWidth() == canvas.width() && targets.getHeight() == canvas.height());
     setBrushColor(Qt::magenta);
     X = canvas.width();
     Y = canvas.height();
-    initZBuffer();
 }
 
-DrawData::DrawData(QImage &canvas, const QImage &texture) : canvas(canvas)
+DrawData::DrawData(
+    Framebuffer &canvas, RenderTargets &targets, ShadingContext &shadingContext, const QImage &texture
+)
+    : DrawData(canvas, targets, shadingContext)
 {
     setTexture(texture);
-    X = canvas.width();
-    Y = canvas.height();
-    initZBuffer();
 }
 
-DrawData::DrawData(QImage &canvas, const QColor &brushColor) : canvas(canvas)
+DrawData::DrawData(
+    Framebuffer &canvas, RenderTargets &targets, ShadingContext &shadingContext, const QColor &brushColor
+)
+    : DrawData(canvas, targets, shadingContext)
 {
     setBrushColor(brushColor);
-    X = canvas.width();
-    Y = canvas.height();
-    initZBuffer();
 }
 
-void DrawData::initZBuffer()
+void DrawData::setBrushColor(const QColor &color)
 {
-    zBuffer.reset(new float[X * Y]);
-    clearZBuffer();
+    brushColor = color;
+    texture    = nullptr;
 }
 
-void DrawData::clearZBuffer() const
+void DrawData::setTexture(const QImage &texture)
 {
-    for (int i = 0; i < X; i++)
-    {
-        for (int j = 0; j < Y; j++)
-        {
-            zBuffer.data()[i * Y + j] = -std::numeric_limits<float>::max();
-        }
-    }
+    this->texture = QSharedPointer<Texture>::create(texture, Settings::getInstance().shadingSettings.textureLayout);
 }
 
-void DrawData::setBrushColor(const QColor &color)
+SurfaceLod DrawData::computeSurfaceLod(const UvGradient &gradient) const
 {
-    brushColor = color;
-    texture    = nullptr;
+    SurfaceLod lod;
+    if (texture)
+        lod.texture = texture->computeLod(gradient);
+    if (normalMap)
+        lod.normalMap = normalMap->computeLod(gradient);
+    return lod;
 }
-
-void DrawData::setTexture(const QImage &texture) { this->texture = QSharedPointer<QImage>::create(texture); }
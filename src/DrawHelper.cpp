@@ -6,7 +6,9 @@
 #include "utils/DrawUtils.h"
 #include <QDebug>
 #include <QVector3D>
+#include <QtConcurrent>
 #include <cmath>
+#include <numeric>
 
 void DrawUtils::drawLine(
     DrawData &drawData, const QVector3D &start, const QVector3D &end, const QColor &color, float width
@@ -47,10 +49,12 @@ void DrawUtils::drawLine(
                 int py = y0 + wy;
                 if (px >= 0 && px < canvasWidth && py >= 0 && py < canvasHeight)
                 {
-                    if (zValue < drawData.zBuffer.data()[px * canvasWidth + py])
+                    if (zValue < drawData.depthAt(px, py))
                         continue;
-                    drawData.zBuffer.data()[px * canvasWidth + py] = zValue;
-                    drawData.canvas.setPixelColor(px, py, color);
+                    drawData.depthAt(px, py) = zValue;
+                    drawData.canvas.setPixel(px, py, color.rgb());
+                    if (drawData.gBuffer)
+                        drawData.gBuffer->invalidate(px, py);
                 }
             }
         }
@@ -72,7 +76,9 @@ void DrawUtils::drawLine(
     }
 }
 
-void DrawUtils::drawPoint(DrawData &drawData, const QVector3D &point, const QColor &color, int radiusX, int radiusY)
+void DrawUtils::drawPoint(
+    DrawData &drawData, const QVector3D &point, const QColor &color, int radiusX, int radiusY, bool writeDepth
+)
 {
     const int canvasWidth  = drawData.canvas.width();
     const int canvasHeight = drawData.canvas.height();
@@ -84,10 +90,13 @@ void DrawUtils::drawPoint(DrawData &drawData, const QVector3D &point, const QCol
         {
             if (xm >= 0 && xm < canvasWidth && ym >= 0 && ym < canvasHeight)
             {
-                if (point.z() < drawData.zBuffer.data()[xm * canvasWidth + ym])
+                if (point.z() < drawData.depthAt(xm, ym))
                     continue;
-                drawData.zBuffer.data()[xm * canvasWidth + ym] = point.z();
-                drawData.canvas.setPixelColor(xm, ym, color);
+                if (writeDepth)
+                    drawData.depthAt(xm, ym) = point.z();
+                drawData.canvas.setPixel(xm, ym, color.rgb());
+                if (drawData.gBuffer)
+                    drawData.gBuffer->invalidate(xm, ym);
             }
         }
     }
@@ -95,56 +104,82 @@ void DrawUtils::drawPoint(DrawData &drawData, const QVector3D &point, const QCol
 
 void
 
-DrawUtils::drawPixel(DrawData &drawData, const QVector3D &position3d, const QVector3D &normal, QColor &color, const int x, const int y)
+DrawUtils::drawPixel(DrawData &drawData, const QVector3D &position3d, const QVector3D &normal, const QRgb color, const int x, const int y)
 {
-    Settings &settings = Settings::getInstance();
-
-    if (settings.lightSettings.isLightSourceEnabled && !drawData.lightSources.empty())
+    const ShadingContext &shading = drawData.shadingContext;
+    if (!shading.isLit())
     {
-        float r = 0.0f;
-        float g = 0.0f;
-        float b = 0.0f;
-        for (QSharedPointer<LightSource> lightSource : drawData.lightSources)
-        {
-            QColor lightColor = lightSource->getColor();
-            QVector3D L       = lightSource->calcVersorTo(position3d).normalized();
-            QVector3D N       = normal;
-            QVector3D V(0.0f, 0.0f, -1.0f);
+        drawData.canvas.setPixel(x, y, color);
+        return;
+    }
 
-            float cosNL = std::max(0.0f, QVector3D::dotProduct(N, L));
-            QVector3D R = (2.0f * QVector3D::dotProduct(N, L) * N - L).normalized();
-            float cosVR = std::max(0.0f, QVector3D::dotProduct(V, R));
+    drawLitPixel(drawData, shading.irradiance(position3d, normal, x, y), color, x, y);
+}
 
-            const float kd = settings.lightSettings.kdCoef;
-            const float ks = settings.lightSettings.ksCoef;
-            const float m  = settings.lightSettings.m;
+void DrawUtils::drawLitPixel(DrawData &drawData, const QVector3D &irradiance, QRgb color, int x, int y)
+{
+    // Clamping and quantization happen once per frame in Framebuffer::resolve
+    constexpr float scale = Framebuffer::ByteToFloat;
+    drawData.canvas.setPixelF(
+        x, y, qRed(color) * scale * irradiance.x(), qGreen(color) * scale * irradiance.y(),
+        qBlue(color) * scale * irradiance.z()
+    );
+}
 
-            float lightPower = 1.0f;
-            if (settings.lightSettings.isReflectorEnabled)
-            {
-                const int mCoeffReflector = settings.lightSettings.mCoeffReflector;
-                lightPower =
-                    std::pow(std::max(0.0f, QVector3D::dotProduct(L, lightSource->getDirection())), mCoeffReflector);
-            }
+QRgb DrawUtils::sampleColor(
+    const QSharedPointer<Texture> &texture, QRgb brushColor, float u, float v, float lod, TextureFilter filter
+)
+{
+    return texture ? texture->sample(u, v, lod, filter) : brushColor;
+}
 
-            float IL_r = lightColor.redF() * lightPower;
-            float IL_g = lightColor.greenF() * lightPower;
-            float IL_b = lightColor.blueF() * lightPower;
+void DrawUtils::sampleNormalMap(
+    const NormalMap &normalMap, float u, float v, float lod, TextureFilter filter, QVector3D &normal,
+    const QVector3D &uTangent, const QVector3D &vTangent
+)
+{
+    // The vertex stage orthonormalized the tangent frame, so tangent space maps to world space without an inverse
+    const QVector3D textureVector = normalMap.sample(u, v, lod, filter);
+    normal = (uTangent * textureVector.x() + vTangent * textureVector.y() + normal * textureVector.z()).normalized();
+}
 
-            float IO_r = color.redF();
-            float IO_g = color.greenF();
-            float IO_b = color.blueF();
+void DrawUtils::shadeGBuffer(DrawData &drawData)
+{
+    GBuffer &gBuffer           = *drawData.gBuffer;
+    const TextureFilter filter = drawData.shadingContext.textureFilter;
 
-            r += kd * IL_r * IO_r * cosNL + ks * IL_r * IO_r * std::pow(cosVR, m);
-            g += kd * IL_g * IO_g * cosNL + ks * IL_g * IO_g * std::pow(cosVR, m);
-            b += kd * IL_b * IO_b * cosNL + ks * IL_b * IO_b * std::pow(cosVR, m);
+    QVector<int> rows(gBuffer.getHeight());
+    std::iota(rows.begin(), rows.end(), 0);
 
-            r = std::min(1.0f, r);
-            g = std::min(1.0f, g);
-            b = std::min(1.0f, b);
-        }
-        color = QColor::fromRgbF(r, g, b);
-    }
+    // Rows are independent, every visible pixel is shaded once regardless of how often it was overdrawn
+    QtConcurrent::blockingMap(
+        rows,
+        [&drawData, &gBuffer, filter](const int y)
+        {
+            for (int x = 0; x < gBuffer.getWidth(); ++x)
+            {
+                const int materialIndex = gBuffer.getMaterialIndex(x, y);
+                if (materialIndex < 0)
+                    continue;
 
-    drawData.canvas.setPixelColor(x, y, color);
+                const GBufferMaterial &material = gBuffer.getMaterial(materialIndex);
+                const QVector3D &pos            = gBuffer.getPosition(x, y);
+                const QVector2D &uv             = gBuffer.getUv(x, y);
+                const SurfaceLod &lod           = gBuffer.getLod(x, y);
+                QVector3D normal                = gBuffer.getNormal(x, y);
+
+                if (material.normalMap)
+                {
+                    sampleNormalMap(
+                        *material.normalMap, uv.x(), uv.y(), lod.normalMap, filter, normal, gBuffer.getUTangent(x, y),
+                        gBuffer.getVTangent(x, y)
+                    );
+                }
+
+                const QRgb color =
+                    sampleColor(material.texture, material.brushColor.rgb(), uv.x(), uv.y(), lod.texture, filter);
+                drawPixel(drawData, pos, normal, color, x, y);
+            }
+        }
+    );
 }
@@ -0,0 +1,61 @@
+//
+// Created by wookie on 11/28/24.
+//
+
+#include "utils/FillUtils.h"
+#include <QVector>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void FillUtils::parallelFill(float *data, qsizetype count, float value)
+{
+    // Small buffers are not worth waking the pool for
+    static constexpr qsizetype chunkSize = 64 * 1024;
+    if (count <= chunkSize)
+    {
+        fill(data, count, value);
+        return;
+    }
+
+    QVector<qsizetype> chunkStarts;
+    for (qsizetype start = 0; start < count; start += chunkSize)
+    {
+        chunkStarts.append(start);
+    }
+
+    QtConcurrent::blockingMap(
+        chunkStarts,
+        [data, count, value](const qsizetype start)
+        {
+            fill(data + start, std::min(chunkSize, count - start), value);
+        }
+    );
+}
+
+void FillUtils::fill(float *data, qsizetype count, float value)
+{
+    qsizetype i = 0;
+#if defined(__SSE2__)
+    // Scalar stores up to the first 16-byte boundary, then aligned four-wide stores
+    while (i < count && reinterpret_cast<std::uintptr_t>(data + i) % 16 != 0)
+    {
+        data[i++] = value;
+    }
+
+    const __m128 values = _mm_set1_ps(value);
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_store_ps(data + i, values);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        data[i] = value;
+    }
+}
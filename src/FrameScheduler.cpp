@@ -0,0 +1,76 @@
+//
+// Created by wookie on 11/29/24.
+//
+
+#include "graphics/FrameScheduler.h"
+#include <algorithm>
+
+namespace
+{
+constexpr qint64 NanosecondsPerSecond      = 1000000000;
+constexpr qint64 NanosecondsPerMillisecond = 1000000;
+constexpr qint64 StepDuration              = NanosecondsPerSecond / FrameScheduler::StepsPerSecond;
+// Weight of the newest frame in the moving average, about the last 20 frames contribute
+constexpr double AverageWeight = 0.1;
+} // namespace
+
+void FrameScheduler::start()
+{
+    _clock.start();
+    _nextFrameStart   = 0;
+    _frameStart       = 0;
+    _lastStepTime     = 0;
+    _accumulator      = 0;
+    _frameTime        = 0.0;
+    _averageFrameTime = 0.0;
+}
+
+qint64 FrameScheduler::getFrameDelay(int targetFps) const
+{
+    if (targetFps <= 0 || !_clock.isValid())
+        return 0;
+
+    const qint64 remaining = _nextFrameStart - _clock.nsecsElapsed();
+    if (remaining <= 0)
+        return 0;
+
+    // Rounded up, waking a millisecond early would only make the caller wait again
+    return (remaining + NanosecondsPerMillisecond - 1) / NanosecondsPerMillisecond;
+}
+
+int FrameScheduler::beginFrame(int targetFps, bool simulate)
+{
+    const qint64 now = _clock.nsecsElapsed();
+    _frameStart      = now;
+
+    if (targetFps > 0)
+    {
+        // Small delays are absorbed by the next frame, a frame late by a whole period moves the schedule
+        const qint64 period = NanosecondsPerSecond / targetFps;
+        if (now - _nextFrameStart >= period)
+            _nextFrameStart = now;
+        _nextFrameStart += period;
+    }
+
+    const qint64 elapsed = now - _lastStepTime;
+    _lastStepTime        = now;
+    if (!simulate)
+    {
+        _accumulator = 0;
+        return 0;
+    }
+
+    // A stalled frame runs at most a few steps, the rest of the stall is dropped
+    _accumulator    = std::min(_accumulator + elapsed, MaxStepsPerFrame * StepDuration);
+    const int steps = static_cast<int>(_accumulator / StepDuration);
+    _accumulator -= steps * StepDuration;
+    _simulationSteps += steps;
+    return steps;
+}
+
+void FrameScheduler::endFrame()
+{
+    _frameTime = static_cast<double>(_clock.nsecsElapsed() - _frameStart) / NanosecondsPerMillisecond;
+    _averageFrameTime =
+        _averageFrameTime == 0.0 ? _frameTime : _averageFrameTime + (_frameTime - _averageFrameTime) * AverageWeight;
+}
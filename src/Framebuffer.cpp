@@ -0,0 +1,200 @@
+//
+// Created by wookie on 11/20/24.
+//
+
+#include "graphics/Framebuffer.h"
+#include "utils/FillUtils.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+Framebuffer::Framebuffer(int width, int height) { resize(width, height); }
+
+void Framebuffer::resize(int width, int height)
+{
+    _width  = width;
+    _height = height;
+    _image  = QImage(width, height, QImage::Format_ARGB32);
+
+    // ARGB32 rows are 32-bit aligned, so the rows are packed without padding
+    Q_ASSERT(_image.isNull() || _image.bytesPerLine() == width * static_cast<int>(sizeof(QRgb)));
+    _pixels = reinterpret_cast<QRgb *>(_image.bits());
+
+    const int size = width * height;
+    _accumulation.resize(3 * size);
+    _red   = _accumulation.data();
+    _green = _red + size;
+    _blue  = _green + size;
+
+    allocateSamples();
+}
+
+void Framebuffer::setSampleCount(int sampleCount)
+{
+    Q_ASSERT(sampleCount == 1 || sampleCount == 4 || sampleCount == 8);
+    if (sampleCount == _sampleCount)
+        return;
+
+    _sampleCount = sampleCount;
+    allocateSamples();
+}
+
+void Framebuffer::allocateSamples()
+{
+    // A single sample is the pixel itself
+    const int size = _sampleCount > 1 ? _width * _height * _sampleCount : 0;
+    _samples.resize(4 * size);
+    _samples.squeeze();
+    _sampleRed   = _samples.data();
+    _sampleGreen = _sampleRed + size;
+    _sampleBlue  = _sampleGreen + size;
+    _sampleDepth = _sampleBlue + size;
+    _sampleDirty.fill(0, _sampleCount > 1 ? _width * _height : 0);
+    _dirty = _sampleDirty.data();
+}
+
+const QVector2D *Framebuffer::getSampleOffsets() const
+{
+    // Standard rotated-grid patterns in sixteenths of a pixel, no two samples share a row or a column
+    static const QVector2D single[] = {{0.0f, 0.0f}};
+    static const QVector2D fourX[]  = {
+        {-2 / 16.0f, -6 / 16.0f}, {6 / 16.0f, -2 / 16.0f}, {-6 / 16.0f, 2 / 16.0f}, {2 / 16.0f, 6 / 16.0f}
+    };
+    static const QVector2D eightX[] = {
+        {1 / 16.0f, -3 / 16.0f}, {-1 / 16.0f, 3 / 16.0f}, {5 / 16.0f, 1 / 16.0f}, {-3 / 16.0f, -5 / 16.0f},
+        {-5 / 16.0f, 5 / 16.0f}, {-7 / 16.0f, -1 / 16.0f}, {3 / 16.0f, 7 / 16.0f}, {7 / 16.0f, -7 / 16.0f}
+    };
+
+    switch (_sampleCount)
+    {
+    case 4:
+        return fourX;
+    case 8:
+        return eightX;
+    default:
+        return single;
+    }
+}
+
+void Framebuffer::fill(QRgb color)
+{
+    const int size    = _width * _height;
+    const float red   = qRed(color) * ByteToFloat;
+    const float green = qGreen(color) * ByteToFloat;
+    const float blue  = qBlue(color) * ByteToFloat;
+    FillUtils::parallelFill(_red, size, red);
+    FillUtils::parallelFill(_green, size, green);
+    FillUtils::parallelFill(_blue, size, blue);
+
+    if (_sampleCount > 1)
+    {
+        const qsizetype samples = static_cast<qsizetype>(size) * _sampleCount;
+        FillUtils::parallelFill(_sampleRed, samples, red);
+        FillUtils::parallelFill(_sampleGreen, samples, green);
+        FillUtils::parallelFill(_sampleBlue, samples, blue);
+        FillUtils::parallelFill(_sampleDepth, samples, -std::numeric_limits<float>::max());
+        std::fill(_dirty, _dirty + size, 0);
+    }
+}
+
+void Framebuffer::resolveSamples(const QRect &rect)
+{
+    const QRect clipped = rect.intersected(QRect(0, 0, _width, _height));
+    if (_sampleCount == 1 || clipped.isEmpty())
+        return;
+
+    const float weight = 1.0f / static_cast<float>(_sampleCount);
+    for (int y = clipped.top(); y <= clipped.bottom(); ++y)
+    {
+        for (int x = clipped.left(); x <= clipped.right(); ++x)
+        {
+            const int pixel = y * _width + x;
+            if (!_dirty[pixel])
+                continue;
+
+            const int sample = pixel * _sampleCount;
+            float red        = 0.0f;
+            float green      = 0.0f;
+            float blue       = 0.0f;
+            for (int i = 0; i < _sampleCount; ++i)
+            {
+                red += _sampleRed[sample + i];
+                green += _sampleGreen[sample + i];
+                blue += _sampleBlue[sample + i];
+            }
+
+            _red[pixel]   = red * weight;
+            _green[pixel] = green * weight;
+            _blue[pixel]  = blue * weight;
+            _dirty[pixel] = 0;
+        }
+    }
+}
+
+void Framebuffer::resolve()
+{
+    QVector<int> rows(_height);
+    std::iota(rows.begin(), rows.end(), 0);
+
+    QtConcurrent::blockingMap(
+        rows,
+        [this](const int y)
+        {
+            resolveRow(y);
+        }
+    );
+}
+
+void Framebuffer::swapImage(QImage &image)
+{
+    Q_ASSERT(image.size() == _image.size() && image.format() == QImage::Format_ARGB32);
+    _image.swap(image);
+    // bits() detaches, so the new target is never shared
+    _pixels = reinterpret_cast<QRgb *>(_image.bits());
+}
+
+void Framebuffer::resolveRow(int y)
+{
+    const float *red   = _red + y * _width;
+    const float *green = _green + y * _width;
+    const float *blue  = _blue + y * _width;
+    QRgb *pixels       = _pixels + y * _width;
+
+    int x = 0;
+#if defined(__SSE2__)
+    // Four pixels per step with the same clamp, scale, round and truncate as packRgbF
+    const __m128 zero    = _mm_setzero_ps();
+    const __m128 one     = _mm_set1_ps(1.0f);
+    const __m128 scale   = _mm_set1_ps(255.0f);
+    const __m128 half    = _mm_set1_ps(0.5f);
+    const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+    auto toBytes = [&](const float *plane)
+    {
+        // max with the value first maps NaN to zero
+        const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(plane + x), zero), one);
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, scale), half));
+    };
+
+    for (; x + 4 <= _width; x += 4)
+    {
+        const __m128i rg   = _mm_or_si128(_mm_slli_epi32(toBytes(red), 16), _mm_slli_epi32(toBytes(green), 8));
+        const __m128i argb = _mm_or_si128(opaque, _mm_or_si128(rg, toBytes(blue)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + x), argb);
+    }
+#endif
+
+    auto clamp = [](float channel)
+    {
+        return std::min(1.0f, std::max(0.0f, channel));
+    };
+    for (; x < _width; ++x)
+    {
+        pixels[x] = packRgbF(clamp(red[x]), clamp(green[x]), clamp(blue[x]));
+    }
+}
@@ -0,0 +1,37 @@
+//
+// Created by wookie on 11/18/24.
+//
+
+#include "models/GBuffer.h"
+
+GBuffer::GBuffer(int width, int height) { resize(width, height); }
+
+void GBuffer::resize(int width, int height)
+{
+    _width  = width;
+    _height = height;
+
+    const int size = width * height;
+    _materialIndices.resize(size);
+    _positions.resize(size);
+    _normals.resize(size);
+    _uvs.resize(size);
+    _uTangents.resize(size);
+    _vTangents.resize(size);
+    _lods.resize(size);
+    clear();
+}
+
+void GBuffer::clear()
+{
+    // Only the coverage plane needs resetting, the attribute planes are overwritten before they are read
+    _materialIndices.fill(-1);
+    _materials.clear();
+    _hasOverlays = false;
+}
+
+int GBuffer::addMaterial(const GBufferMaterial &material)
+{
+    _materials.append(material);
+    return _materials.size() - 1;
+}
@@ -0,0 +1,105 @@
+//
+// Created by wookie on 11/19/24.
+//
+
+#include "models/HierarchicalZBuffer.h"
+#include <algorithm>
+#include <limits>
+
+HierarchicalZBuffer::HierarchicalZBuffer(int width, int height, int blockSize) { resize(width, height, blockSize); }
+
+void HierarchicalZBuffer::resize(int width, int height, int blockSize)
+{
+    Q_ASSERT(blockSize > 0);
+    _width     = width;
+    _height    = height;
+    _blockSize = blockSize;
+    _blocksX   = (width + blockSize - 1) / blockSize;
+    _blocksY   = (height + blockSize - 1) / blockSize;
+
+    _minDepths.resize(_blocksX * _blocksY);
+    _maxDepths.resize(_blocksX * _blocksY);
+    _dirty.resize(_blocksX * _blocksY);
+    clear();
+}
+
+void HierarchicalZBuffer::clear()
+{
+    _minDepths.fill(-std::numeric_limits<float>::max());
+    _maxDepths.fill(-std::numeric_limits<float>::max());
+    _dirty.fill(0);
+    _testedCount.storeRelaxed(0);
+    _rejectedCount.storeRelaxed(0);
+}
+
+bool HierarchicalZBuffer::isOccluded(const float *zBuffer, const QRect &rect, float nearestDepth)
+{
+    const int blockMinX = rect.left() / _blockSize;
+    const int blockMaxX = rect.right() / _blockSize;
+    const int blockMinY = rect.top() / _blockSize;
+    const int blockMaxY = rect.bottom() / _blockSize;
+
+    for (int by = blockMinY; by <= blockMaxY; by++)
+    {
+        for (int bx = blockMinX; bx <= blockMaxX; bx++)
+        {
+            // Same comparison as the per-pixel test, a tie still has to be rasterized
+            const int block = by * _blocksX + bx;
+            if (nearestDepth < _minDepths[block])
+                continue;
+            if (!_dirty[block])
+                return false;
+
+            refreshBlock(zBuffer, bx, by);
+            if (!(nearestDepth < _minDepths[block]))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void HierarchicalZBuffer::addCounts(qint64 tested, qint64 rejected)
+{
+    _testedCount.fetchAndAddRelaxed(tested);
+    _rejectedCount.fetchAndAddRelaxed(rejected);
+}
+
+void HierarchicalZBuffer::invalidate(const QRect &rect)
+{
+    const int blockMinX = rect.left() / _blockSize;
+    const int blockMaxX = rect.right() / _blockSize;
+    const int blockMinY = rect.top() / _blockSize;
+    const int blockMaxY = rect.bottom() / _blockSize;
+
+    for (int by = blockMinY; by <= blockMaxY; by++)
+    {
+        for (int bx = blockMinX; bx <= blockMaxX; bx++)
+            _dirty[by * _blocksX + bx] = 1;
+    }
+}
+
+void HierarchicalZBuffer::refreshBlock(const float *zBuffer, int blockX, int blockY)
+{
+    const int xStart = blockX * _blockSize;
+    const int xEnd   = std::min(xStart + _blockSize, _width);
+    const int yStart = blockY * _blockSize;
+    const int yEnd   = std::min(yStart + _blockSize, _height);
+
+    float minDepth = std::numeric_limits<float>::max();
+    float maxDepth = -std::numeric_limits<float>::max();
+    for (int y = yStart; y < yEnd; y++)
+    {
+        const float *row = zBuffer + y * _width;
+        for (int x = xStart; x < xEnd; x++)
+        {
+            minDepth = std::min(minDepth, row[x]);
+            maxDepth = std::max(maxDepth, row[x]);
+        }
+    }
+
+    const int block   = blockY * _blocksX + blockX;
+    _minDepths[block] = minDepth;
+    _maxDepths[block] = maxDepth;
+    _dirty[block]     = 0;
+}
@@ -0,0 +1,68 @@
+//
+// Created by wookie on 11/27/24.
+//
+
+#include "models/LightGrid.h"
+#include <numeric>
+
+template <typename Function> void LightGrid::forEachTile(const QRect &bounds, Function function) const
+{
+    const QRect clipped = bounds.intersected(QRect(0, 0, _width, _height));
+    if (clipped.isEmpty())
+        return;
+
+    for (int ty = clipped.top() / _tileSize; ty <= clipped.bottom() / _tileSize; ty++)
+    {
+        for (int tx = clipped.left() / _tileSize; tx <= clipped.right() / _tileSize; tx++)
+        {
+            function(ty * _tilesX + tx);
+        }
+    }
+}
+
+void LightGrid::build(const QVector<QRect> &lightBounds, int width, int height, int tileSize)
+{
+    Q_ASSERT(tileSize > 0);
+    _width    = width;
+    _height   = height;
+    _tileSize = tileSize;
+    _tilesX   = (width + tileSize - 1) / tileSize;
+    _tilesY   = (height + tileSize - 1) / tileSize;
+
+    // Counting pass, then a prefix sum turns the counts into offsets and a second pass fills the lists in light order
+    _tileOffsets.fill(0, _tilesX * _tilesY + 1);
+    int *offsets = _tileOffsets.data();
+    for (const QRect &bounds : lightBounds)
+    {
+        forEachTile(
+            bounds,
+            [offsets](const int tile)
+            {
+                offsets[tile + 1]++;
+            }
+        );
+    }
+    std::partial_sum(_tileOffsets.begin(), _tileOffsets.end(), _tileOffsets.begin());
+
+    _lightIndices.resize(_tileOffsets.last());
+    // Next free slot of every tile, starting at its offset
+    QVector<int> cursors = _tileOffsets;
+    int *next            = cursors.data();
+    int *lightIndices    = _lightIndices.data();
+    for (int light = 0; light < lightBounds.size(); light++)
+    {
+        forEachTile(
+            lightBounds[light],
+            [next, lightIndices, light](const int tile)
+            {
+                lightIndices[next[tile]++] = light;
+            }
+        );
+    }
+}
+
+void LightGrid::clear()
+{
+    _tileOffsets.clear();
+    _lightIndices.clear();
+}
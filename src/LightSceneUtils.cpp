@@ -0,0 +1,32 @@
+//
+// Created by wookie on 12/1/24.
+//
+
+#include "utils/LightSceneUtils.h"
+#include <QColor>
+#include <cmath>
+
+QVector<QSharedPointer<LightSource>> LightSceneUtils::createSmallLights(int count, float radius, float z)
+{
+    QVector<QSharedPointer<LightSource>> lights;
+    if (count <= 0)
+        return lights;
+
+    lights.reserve(count);
+    const int side    = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+    const float pitch = 1.0f / static_cast<float>(side);
+    for (int i = 0; i < count; ++i)
+    {
+        const QColor color = QColor::fromHsvF(static_cast<float>(i) / static_cast<float>(count), 0.6f, 1.0f);
+        auto light         = QSharedPointer<LightSource>(new LightSource(color));
+        light->setPosition(QVector3D(
+            (static_cast<float>(i % side) + 0.5f) * pitch, (static_cast<float>(i / side) + 0.5f) * pitch, z
+        ));
+        // Reflectors light only along their direction, these look at the models behind them
+        light->setDirection(QVector3D(0.0f, 0.0f, -1.0f));
+        light->setRadius(radius);
+        light->setOrbiting(false);
+        lights.append(light);
+    }
+    return lights;
+}
@@ -10,16 +10,16 @@
 
 void LightSource::draw(DrawData &drawData)
 {
-    const float zFactor = 1.0f + position.z();
+    const float zFactor = (1.0f + position.z()) * drawData.resolutionScale;
 
     Settings &settings = Settings::getInstance();
     DrawUtils::drawPoint(
         drawData, position, Qt::black, settings.lightSettings.lightSourceObjectSize * 2 * zFactor,
-        settings.lightSettings.lightSourceObjectSize * 2 * zFactor
+        settings.lightSettings.lightSourceObjectSize * 2 * zFactor, false
     );
     DrawUtils::drawPoint(
         drawData, position, color, settings.lightSettings.lightSourceObjectSize * zFactor,
-        settings.lightSettings.lightSourceObjectSize * zFactor
+        settings.lightSettings.lightSourceObjectSize * zFactor, false
     );
 }
 
@@ -1,8 +1,10 @@
 #include "ui/MainWindow.h"
 #include "geometry/BezierSurface.h"
 #include "graphics/QGraphicsEngine.h"
+#include "utils/LightSceneUtils.h"
 #include <QCheckBox>
 #include <QColorDialog>
+#include <QComboBox>
 #include <QFileDialog>
 #include <QGraphicsScene>
 #include <QGraphicsView>
@@ -13,9 +15,16 @@
 #include <QSlider>
 #include <QSpacerItem>
 #include <QSplitter>
+#include <QStatusBar>
 #include <QTimer>
 #include <QVBoxLayout>
 
+namespace
+{
+// Often enough to follow the counters, rarely enough that the label stays readable
+constexpr int StatsRefreshIntervalMs = 500;
+} // namespace
+
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 {
     Settings &settings = Settings::getInstance();
@@ -46,9 +55,9 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     QSlider *zRotationSlider;
     setupRotationBox(centralWidget, leftToolbarLayout, xRotationSlider, yRotationSlider, zRotationSlider);
 
-    setupLightningBox(centralWidget, leftToolbarLayout);
+    setupLightningBox(centralWidget, engine, leftToolbarLayout);
 
-    setupBezierSurfaceBox(centralWidget, leftToolbarLayout);
+    setupBezierSurfaceBox(centralWidget, engine, leftToolbarLayout);
 
     setupMiscBox(
         centralWidget, engine, bezierSurface, lightSource, leftToolbarLayout, xRotationSlider, yRotationSlider,
@@ -69,7 +78,46 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     QVBoxLayout *mainLayout = new QVBoxLayout(centralWidget);
     mainLayout->addWidget(mainSplitter);
 
-    engine->setupAnimationTimer();
+    setupStatsBar(engine);
+
+    engine->startRenderThread();
+}
+
+void MainWindow::setupStatsBar(QGraphicsEngine *engine)
+{
+    QLabel *statsLabel     = new QLabel();
+    QLabel *frameTimeLabel = new QLabel();
+    statusBar()->addWidget(statsLabel);
+    statusBar()->addPermanentWidget(frameTimeLabel);
+
+    // The render thread publishes the counters with each frame, polling them keeps the GUI out of its way
+    QTimer *statsTimer = new QTimer(this);
+    connect(
+        statsTimer, &QTimer::timeout,
+        [=]()
+        {
+            const RenderStats stats = engine->getRenderStats();
+            const double averageFps = stats.averageFrameTime > 0.0 ? 1000.0 / stats.averageFrameTime : 0.0;
+            frameTimeLabel->setText(QString("Frame: %1 ms, average %2 ms (%3 fps)")
+                                        .arg(stats.frameTime, 0, 'f', 1)
+                                        .arg(stats.averageFrameTime, 0, 'f', 1)
+                                        .arg(averageFps, 0, 'f', 0));
+
+            if (stats.relit)
+            {
+                statsLabel->setText("HiZ: frame relit from the G-buffer");
+                return;
+            }
+
+            const double rejectedRate =
+                stats.hiZTested > 0 ? 100.0 * static_cast<double>(stats.hiZRejected) / stats.hiZTested : 0.0;
+            statsLabel->setText(QString("HiZ: %1 tests, %2 rejected (%3%)")
+                                    .arg(stats.hiZTested)
+                                    .arg(stats.hiZRejected)
+                                    .arg(rejectedRate, 0, 'f', 1));
+        }
+    );
+    statsTimer->start(StatsRefreshIntervalMs);
 }
 
 void MainWindow::setupMiscBox(
@@ -99,8 +147,13 @@ void MainWindow::setupMiscBox(
             rotationX = xRotationSlider->value();
             rotationY = yRotationSlider->value();
             rotationZ = zRotationSlider->value();
-            bezierSurface->setTessellationLevel(value);
-            engine->setRotation(rotationX, rotationY, rotationZ);
+            engine->post(
+                [=]()
+                {
+                    bezierSurface->setTessellationLevel(value);
+                    engine->setRotation(rotationX, rotationY, rotationZ);
+                }
+            );
         }
     );
 
@@ -121,14 +174,21 @@ void MainWindow::setupMiscBox(
             QGraphicsEngine *engine = dynamic_cast<QGraphicsEngine *>(mainView->scene()->items().first());
             if (engine && !path.isEmpty())
             {
-                for (auto drawable : engine->getDrawables())
-                {
-                    auto mesh = qSharedPointerCast<Mesh>(drawable);
-                    if (mesh)
+                // Loaded here, only the swap waits for the render thread
+                QSharedPointer<QImage> image(new QImage(path));
+                engine->post(
+                    [engine, image]()
                     {
-                        mesh->setNormalMap(QSharedPointer<QImage>(new QImage(path)));
+                        for (auto drawable : engine->getDrawables())
+                        {
+                            auto mesh = qSharedPointerCast<Mesh>(drawable);
+                            if (mesh)
+                            {
+                                mesh->setNormalMap(image);
+                            }
+                        }
                     }
-                }
+                );
             }
         }
     );
@@ -148,14 +208,21 @@ void MainWindow::setupMiscBox(
             QGraphicsEngine *engine = dynamic_cast<QGraphicsEngine *>(mainView->scene()->items().first());
             if (!path.isEmpty() && engine)
             {
-                for (auto drawable : engine->getDrawables())
-                {
-                    auto mesh = qSharedPointerCast<Mesh>(drawable);
-                    if (mesh)
+                // Loaded here, only the swap waits for the render thread
+                QSharedPointer<QImage> image(new QImage(path));
+                engine->post(
+                    [engine, image]()
                     {
-                        mesh->setTexture(QSharedPointer<QImage>(new QImage(path)));
+                        for (auto drawable : engine->getDrawables())
+                        {
+                            auto mesh = qSharedPointerCast<Mesh>(drawable);
+                            if (mesh)
+                            {
+                                mesh->setTexture(image);
+                            }
+                        }
                     }
-                }
+                );
             }
         }
     );
@@ -167,7 +234,12 @@ void MainWindow::setupMiscBox(
         clearTextureButton, &QPushButton::clicked,
         [=](bool)
         {
-            bezierSurface->setTexture(nullptr);
+            engine->post(
+                [bezierSurface]()
+                {
+                    bezierSurface->setTexture(nullptr);
+                }
+            );
         }
     );
 
@@ -178,7 +250,12 @@ void MainWindow::setupMiscBox(
         clearNormalMapButton, &QPushButton::clicked,
         [=](bool)
         {
-            bezierSurface->setNormalMap(nullptr);
+            engine->post(
+                [bezierSurface]()
+                {
+                    bezierSurface->setNormalMap(nullptr);
+                }
+            );
         }
     );
 
@@ -192,8 +269,13 @@ void MainWindow::setupMiscBox(
             QColor color = QColorDialog::getColor(Qt::white, centralWidget);
             if (color.isValid())
             {
-                Settings &settings                          = Settings::getInstance();
-                settings.bezierSurfaceSettings.defaultColor = color;
+                engine->post(
+                    [color]()
+                    {
+                        Settings &settings                          = Settings::getInstance();
+                        settings.bezierSurfaceSettings.defaultColor = color;
+                    }
+                );
             }
         }
     );
@@ -208,8 +290,12 @@ void MainWindow::setupMiscBox(
             QColor color = QColorDialog::getColor(Qt::white, centralWidget);
             if (color.isValid())
             {
-                Settings &settings = Settings::getInstance();
-                lightSource->setColor(color);
+                engine->post(
+                    [lightSource, color]()
+                    {
+                        lightSource->setColor(color);
+                    }
+                );
             }
         }
     );
@@ -225,14 +311,82 @@ void MainWindow::setupMiscBox(
         }
     );
 
-    QLabel *animationStoppedLabel = new QLabel("If animation is stopped, sliders are inactivated");
+    QLabel *frameRateLabel       = new QLabel("Frame Rate");
+    QComboBox *frameRateComboBox = new QComboBox();
+    frameRateComboBox->addItem("30 FPS", 30);
+    frameRateComboBox->addItem("60 FPS", 60);
+    frameRateComboBox->addItem("120 FPS", 120);
+    frameRateComboBox->addItem("Unlimited", 0);
+    frameRateComboBox->setCurrentIndex(
+        frameRateComboBox->findData(Settings::getInstance().graphicsEngineSettings.targetFps)
+    );
+    normalMapLayout->addWidget(frameRateLabel);
+    normalMapLayout->addWidget(frameRateComboBox);
+    connect(
+        frameRateComboBox, qOverload<int>(&QComboBox::currentIndexChanged),
+        [engine, frameRateComboBox](int index)
+        {
+            const int targetFps = frameRateComboBox->itemData(index).toInt();
+            engine->post(
+                [targetFps]()
+                {
+                    Settings &settings                        = Settings::getInstance();
+                    settings.graphicsEngineSettings.targetFps = targetFps;
+                }
+            );
+        }
+    );
+
+    QCheckBox *dynamicResolutionCheckbox = new QCheckBox("Dynamic Resolution");
+    dynamicResolutionCheckbox->setChecked(Settings::getInstance().graphicsEngineSettings.dynamicResolution);
+    normalMapLayout->addWidget(dynamicResolutionCheckbox);
+    connect(
+        dynamicResolutionCheckbox, &QCheckBox::stateChanged,
+        [engine](int state)
+        {
+            engine->post(
+                [state]()
+                {
+                    Settings &settings                                = Settings::getInstance();
+                    settings.graphicsEngineSettings.dynamicResolution = state == Qt::Checked;
+                }
+            );
+        }
+    );
+
+    QLabel *upscaleFilterLabel       = new QLabel("Upscale Filter");
+    QComboBox *upscaleFilterComboBox = new QComboBox();
+    upscaleFilterComboBox->addItem("Bilinear", static_cast<int>(UpscaleFilter::Bilinear));
+    upscaleFilterComboBox->addItem("Edge-Aware", static_cast<int>(UpscaleFilter::EdgeAware));
+    upscaleFilterComboBox->setCurrentIndex(
+        static_cast<int>(Settings::getInstance().graphicsEngineSettings.upscaleFilter)
+    );
+    normalMapLayout->addWidget(upscaleFilterLabel);
+    normalMapLayout->addWidget(upscaleFilterComboBox);
+    connect(
+        upscaleFilterComboBox, qOverload<int>(&QComboBox::currentIndexChanged),
+        [engine](int index)
+        {
+            engine->post(
+                [index]()
+                {
+                    Settings &settings                            = Settings::getInstance();
+                    settings.graphicsEngineSettings.upscaleFilter = static_cast<UpscaleFilter>(index);
+                }
+            );
+        }
+    );
+
+    QLabel *animationStoppedLabel = new QLabel("If animation is stopped, only rotation redraws the scene");
     animationStoppedLabel->setAlignment(Qt::AlignCenter);
     normalMapLayout->addWidget(animationStoppedLabel);
 
     leftToolbarLayout->addWidget(normalMapBox);
 }
 
-void MainWindow::setupBezierSurfaceBox(const QWidget *centralWidget, QVBoxLayout *leftToolbarLayout) const
+void MainWindow::setupBezierSurfaceBox(
+    const QWidget *centralWidget, QGraphicsEngine *engine, QVBoxLayout *leftToolbarLayout
+) const
 {
     Settings &settings               = Settings::getInstance();
     QGroupBox *bezierSurfaceBox      = new QGroupBox();
@@ -244,10 +398,15 @@ void MainWindow::setupBezierSurfaceBox(const QWidget *centralWidget, QVBoxLayout
     bezierSurfaceLayout->addWidget(bezierSurfaceCheckbox);
     connect(
         bezierSurfaceCheckbox, &QCheckBox::stateChanged,
-        [centralWidget](int state)
+        [engine](int state)
         {
-            Settings &settings                  = Settings::getInstance();
-            settings.triangleSettings.debugDraw = state == Qt::Checked;
+            engine->post(
+                [state]()
+                {
+                    Settings &settings                  = Settings::getInstance();
+                    settings.triangleSettings.debugDraw = state == Qt::Checked;
+                }
+            );
         }
     );
     QCheckBox *bezierSurfaceCheckbox2 = new QCheckBox("Draw Normals - (In Debug Mode)");
@@ -255,10 +414,15 @@ void MainWindow::setupBezierSurfaceBox(const QWidget *centralWidget, QVBoxLayout
     bezierSurfaceLayout->addWidget(bezierSurfaceCheckbox2);
     connect(
         bezierSurfaceCheckbox2, &QCheckBox::stateChanged,
-        [centralWidget](int state)
+        [engine](int state)
         {
-            Settings &settings                  = Settings::getInstance();
-            settings.vertexSettings.drawNormals = state == Qt::Checked;
+            engine->post(
+                [state]()
+                {
+                    Settings &settings                  = Settings::getInstance();
+                    settings.vertexSettings.drawNormals = state == Qt::Checked;
+                }
+            );
         }
     );
     QCheckBox *bezierSurfaceCheckbox3 = new QCheckBox("Draw Tangents - (In Debug Mode)");
@@ -266,10 +430,15 @@ void MainWindow::setupBezierSurfaceBox(const QWidget *centralWidget, QVBoxLayout
     bezierSurfaceLayout->addWidget(bezierSurfaceCheckbox3);
     connect(
         bezierSurfaceCheckbox3, &QCheckBox::stateChanged,
-        [centralWidget](int state)
+        [engine](int state)
         {
-            Settings &settings                   = Settings::getInstance();
-            settings.vertexSettings.drawTangents = state == Qt::Checked;
+            engine->post(
+                [state]()
+                {
+                    Settings &settings                   = Settings::getInstance();
+                    settings.vertexSettings.drawTangents = state == Qt::Checked;
+                }
+            );
         }
     );
 
@@ -278,10 +447,15 @@ void MainWindow::setupBezierSurfaceBox(const QWidget *centralWidget, QVBoxLayout
     bezierSurfaceLayout->addWidget(bezierSurfaceCheckbox4);
     connect(
         bezierSurfaceCheckbox4, &QCheckBox::stateChanged,
-        [centralWidget](int state)
+        [engine](int state)
         {
-            Settings &settings                               = Settings::getInstance();
-            settings.bezierSurfaceSettings.showControlPoints = state == Qt::Checked;
+            engine->post(
+                [state]()
+                {
+                    Settings &settings                               = Settings::getInstance();
+                    settings.bezierSurfaceSettings.showControlPoints = state == Qt::Checked;
+                }
+            );
         }
     );
 
@@ -290,17 +464,190 @@ void MainWindow::setupBezierSurfaceBox(const QWidget *centralWidget, QVBoxLayout
     bezierSurfaceLayout->addWidget(bezierSurfaceCheckbox5);
     connect(
         bezierSurfaceCheckbox5, &QCheckBox::stateChanged,
-        [centralWidget](int state)
+        [engine](int state)
+        {
+            engine->post(
+                [state]()
+                {
+                    Settings &settings                          = Settings::getInstance();
+                    settings.lightSettings.isLightSourceEnabled = state == Qt::Checked;
+                }
+            );
+        }
+    );
+
+    QCheckBox *deferredShadingCheckbox = new QCheckBox("Deferred Shading");
+    deferredShadingCheckbox->setChecked(settings.shadingSettings.deferredShading);
+    bezierSurfaceLayout->addWidget(deferredShadingCheckbox);
+    connect(
+        deferredShadingCheckbox, &QCheckBox::stateChanged,
+        [engine](int state)
+        {
+            engine->post(
+                [state]()
+                {
+                    Settings &settings                       = Settings::getInstance();
+                    settings.shadingSettings.deferredShading = state == Qt::Checked;
+                }
+            );
+        }
+    );
+
+    QCheckBox *shadowsCheckbox = new QCheckBox("Shadows");
+    shadowsCheckbox->setChecked(settings.shadingSettings.shadows);
+    bezierSurfaceLayout->addWidget(shadowsCheckbox);
+    connect(
+        shadowsCheckbox, &QCheckBox::stateChanged,
+        [engine](int state)
+        {
+            engine->post(
+                [state]()
+                {
+                    Settings &settings               = Settings::getInstance();
+                    settings.shadingSettings.shadows = state == Qt::Checked;
+                }
+            );
+        }
+    );
+
+    QLabel *rasterizerLabel       = new QLabel("Rasterizer");
+    QComboBox *rasterizerComboBox = new QComboBox();
+    rasterizerComboBox->addItem("Scanline", static_cast<int>(RasterizationMode::Scanline));
+    rasterizerComboBox->addItem("Half-Space", static_cast<int>(RasterizationMode::HalfSpace));
+    rasterizerComboBox->addItem("Half-Space SIMD", static_cast<int>(RasterizationMode::HalfSpaceSimd));
+    rasterizerComboBox->setCurrentIndex(static_cast<int>(settings.rasterizerSettings.rasterizationMode));
+    bezierSurfaceLayout->addWidget(rasterizerLabel);
+    bezierSurfaceLayout->addWidget(rasterizerComboBox);
+    connect(
+        rasterizerComboBox, qOverload<int>(&QComboBox::currentIndexChanged),
+        [engine](int index)
         {
-            Settings &settings                          = Settings::getInstance();
-            settings.lightSettings.isLightSourceEnabled = state == Qt::Checked;
+            engine->post(
+                [index]()
+                {
+                    Settings &settings                            = Settings::getInstance();
+                    settings.rasterizerSettings.rasterizationMode = static_cast<RasterizationMode>(index);
+                }
+            );
+        }
+    );
+
+    QLabel *resolveLabel       = new QLabel("Resolve");
+    QComboBox *resolveComboBox = new QComboBox();
+    resolveComboBox->addItem("Tile Binned", static_cast<int>(ResolveMode::TileBinned));
+    resolveComboBox->addItem("Atomic Visibility", static_cast<int>(ResolveMode::AtomicVisibility));
+    resolveComboBox->setCurrentIndex(static_cast<int>(settings.rasterizerSettings.resolveMode));
+    bezierSurfaceLayout->addWidget(resolveLabel);
+    bezierSurfaceLayout->addWidget(resolveComboBox);
+    connect(
+        resolveComboBox, qOverload<int>(&QComboBox::currentIndexChanged),
+        [engine](int index)
+        {
+            engine->post(
+                [index]()
+                {
+                    Settings &settings                      = Settings::getInstance();
+                    settings.rasterizerSettings.resolveMode = static_cast<ResolveMode>(index);
+                }
+            );
+        }
+    );
+
+    QLabel *multisamplingLabel       = new QLabel("Multisampling");
+    QComboBox *multisamplingComboBox = new QComboBox();
+    multisamplingComboBox->addItem("Off", static_cast<int>(Multisampling::Off));
+    multisamplingComboBox->addItem("4x MSAA", static_cast<int>(Multisampling::X4));
+    multisamplingComboBox->addItem("8x MSAA", static_cast<int>(Multisampling::X8));
+    multisamplingComboBox->setCurrentIndex(static_cast<int>(settings.rasterizerSettings.multisampling));
+    bezierSurfaceLayout->addWidget(multisamplingLabel);
+    bezierSurfaceLayout->addWidget(multisamplingComboBox);
+    connect(
+        multisamplingComboBox, qOverload<int>(&QComboBox::currentIndexChanged),
+        [engine](int index)
+        {
+            engine->post(
+                [index]()
+                {
+                    Settings &settings                        = Settings::getInstance();
+                    settings.rasterizerSettings.multisampling = static_cast<Multisampling>(index);
+                }
+            );
+        }
+    );
+
+    QLabel *shadingRateLabel       = new QLabel("Shading Rate");
+    QComboBox *shadingRateComboBox = new QComboBox();
+    shadingRateComboBox->addItem("Per Pixel", static_cast<int>(ShadingRate::PerPixel));
+    shadingRateComboBox->addItem("Per Vertex", static_cast<int>(ShadingRate::PerVertex));
+    shadingRateComboBox->addItem("Automatic", static_cast<int>(ShadingRate::Automatic));
+    shadingRateComboBox->setCurrentIndex(static_cast<int>(settings.shadingSettings.shadingRate));
+    bezierSurfaceLayout->addWidget(shadingRateLabel);
+    bezierSurfaceLayout->addWidget(shadingRateComboBox);
+    connect(
+        shadingRateComboBox, qOverload<int>(&QComboBox::currentIndexChanged),
+        [engine](int index)
+        {
+            engine->post(
+                [index]()
+                {
+                    Settings &settings                   = Settings::getInstance();
+                    settings.shadingSettings.shadingRate = static_cast<ShadingRate>(index);
+                }
+            );
+        }
+    );
+
+    QLabel *textureFilterLabel       = new QLabel("Texture Filter");
+    QComboBox *textureFilterComboBox = new QComboBox();
+    textureFilterComboBox->addItem("Nearest", static_cast<int>(TextureFilter::Nearest));
+    textureFilterComboBox->addItem("Bilinear", static_cast<int>(TextureFilter::Bilinear));
+    textureFilterComboBox->addItem("Trilinear", static_cast<int>(TextureFilter::Trilinear));
+    textureFilterComboBox->setCurrentIndex(static_cast<int>(settings.shadingSettings.textureFilter));
+    bezierSurfaceLayout->addWidget(textureFilterLabel);
+    bezierSurfaceLayout->addWidget(textureFilterComboBox);
+    connect(
+        textureFilterComboBox, qOverload<int>(&QComboBox::currentIndexChanged),
+        [engine](int index)
+        {
+            engine->post(
+                [index]()
+                {
+                    Settings &settings                     = Settings::getInstance();
+                    settings.shadingSettings.textureFilter = static_cast<TextureFilter>(index);
+                }
+            );
+        }
+    );
+
+    // Only textures loaded afterwards pick up a new layout
+    QLabel *textureLayoutLabel       = new QLabel("Texture Layout");
+    QComboBox *textureLayoutComboBox = new QComboBox();
+    textureLayoutComboBox->addItem("Row-Major", static_cast<int>(TextureLayout::RowMajor));
+    textureLayoutComboBox->addItem("Tiled 4x4", static_cast<int>(TextureLayout::Tiled));
+    textureLayoutComboBox->addItem("Morton", static_cast<int>(TextureLayout::Morton));
+    textureLayoutComboBox->setCurrentIndex(static_cast<int>(settings.shadingSettings.textureLayout));
+    bezierSurfaceLayout->addWidget(textureLayoutLabel);
+    bezierSurfaceLayout->addWidget(textureLayoutComboBox);
+    connect(
+        textureLayoutComboBox, qOverload<int>(&QComboBox::currentIndexChanged),
+        [engine](int index)
+        {
+            engine->post(
+                [index]()
+                {
+                    Settings &settings                     = Settings::getInstance();
+                    settings.shadingSettings.textureLayout = static_cast<TextureLayout>(index);
+                }
+            );
         }
     );
 
     leftToolbarLayout->addWidget(bezierSurfaceBox);
 }
 
-void MainWindow::setupLightningBox(const QWidget *centralWidget, QVBoxLayout *leftToolbarLayout) const
+void MainWindow::setupLightningBox(
+    const QWidget *centralWidget, QGraphicsEngine *engine, QVBoxLayout *leftToolbarLayout
+) const
 {
     QGroupBox *lightSettingsBox      = new QGroupBox();
     QVBoxLayout *lightSettingsLayout = new QVBoxLayout(lightSettingsBox);
@@ -316,10 +663,15 @@ void MainWindow::setupLightningBox(const QWidget *centralWidget, QVBoxLayout *le
     lightSettingsLayout->addWidget(kdSlider);
     connect(
         kdSlider, &QSlider::valueChanged,
-        [centralWidget](int value)
+        [engine](int value)
         {
-            Settings &settings            = Settings::getInstance();
-            settings.lightSettings.kdCoef = value / 100.0f;
+            engine->post(
+                [value]()
+                {
+                    Settings &settings            = Settings::getInstance();
+                    settings.lightSettings.kdCoef = value / 100.0f;
+                }
+            );
         }
     );
 
@@ -333,10 +685,15 @@ void MainWindow::setupLightningBox(const QWidget *centralWidget, QVBoxLayout *le
     lightSettingsLayout->addWidget(ksSlider);
     connect(
         ksSlider, &QSlider::valueChanged,
-        [centralWidget](int value)
+        [engine](int value)
         {
-            Settings &settings            = Settings::getInstance();
-            settings.lightSettings.ksCoef = value / 100.0f;
+            engine->post(
+                [value]()
+                {
+                    Settings &settings            = Settings::getInstance();
+                    settings.lightSettings.ksCoef = value / 100.0f;
+                }
+            );
         }
     );
 
@@ -350,10 +707,15 @@ void MainWindow::setupLightningBox(const QWidget *centralWidget, QVBoxLayout *le
     lightSettingsLayout->addWidget(mSlider);
     connect(
         mSlider, &QSlider::valueChanged,
-        [centralWidget](int value)
+        [engine](int value)
         {
-            Settings &settings       = Settings::getInstance();
-            settings.lightSettings.m = value;
+            engine->post(
+                [value]()
+                {
+                    Settings &settings       = Settings::getInstance();
+                    settings.lightSettings.m = value;
+                }
+            );
         }
     );
 
@@ -368,11 +730,16 @@ void MainWindow::setupLightningBox(const QWidget *centralWidget, QVBoxLayout *le
     lightSettingsLayout->addWidget(lightSourceSlider);
     connect(
         lightSourceSlider, &QSlider::valueChanged,
-        [centralWidget, divConst](int value)
+        [engine, divConst](int value)
         {
-            Settings &settings     = Settings::getInstance();
-            QVector3D &lightCenter = settings.lightSettings.orbitCenter;
-            lightCenter.setZ(value / (float)divConst);
+            engine->post(
+                [value, divConst]()
+                {
+                    Settings &settings     = Settings::getInstance();
+                    QVector3D &lightCenter = settings.lightSettings.orbitCenter;
+                    lightCenter.setZ(value / (float)divConst);
+                }
+            );
         }
     );
 
@@ -383,10 +750,15 @@ void MainWindow::setupLightningBox(const QWidget *centralWidget, QVBoxLayout *le
     lightSettingsLayout->addWidget(lightSourceCheckbox2);
     connect(
         lightSourceCheckbox2, &QCheckBox::stateChanged,
-        [centralWidget](int state)
+        [engine](int state)
         {
-            Settings &settings                        = Settings::getInstance();
-            settings.lightSettings.isReflectorEnabled = state == Qt::Checked;
+            engine->post(
+                [state]()
+                {
+                    Settings &settings                        = Settings::getInstance();
+                    settings.lightSettings.isReflectorEnabled = state == Qt::Checked;
+                }
+            );
         }
     );
 
@@ -400,10 +772,84 @@ void MainWindow::setupLightningBox(const QWidget *centralWidget, QVBoxLayout *le
     lightSettingsLayout->addWidget(lightSourceSlider3);
     connect(
         lightSourceSlider3, &QSlider::valueChanged,
-        [centralWidget](int value)
+        [engine](int value)
         {
-            Settings &settings                     = Settings::getInstance();
-            settings.lightSettings.mCoeffReflector = value;
+            engine->post(
+                [value]()
+                {
+                    Settings &settings                     = Settings::getInstance();
+                    settings.lightSettings.mCoeffReflector = value;
+                }
+            );
+        }
+    );
+
+    // Lights outside a tile's reach are culled from it, 0 lets the orbiting lights reach every pixel
+    QLabel *lightRadiusLabel   = new QLabel("Light Radius");
+    QSlider *lightRadiusSlider = new QSlider(Qt::Horizontal);
+    lightRadiusSlider->setRange(0, 150);
+    lightRadiusSlider->setValue(qRound(Settings::getInstance().lightSettings.lightRadius * 100.0f));
+    lightRadiusSlider->setTickInterval(10);
+    lightRadiusSlider->setTickPosition(QSlider::TicksBelow);
+    lightSettingsLayout->addWidget(lightRadiusLabel);
+    lightSettingsLayout->addWidget(lightRadiusSlider);
+    connect(
+        lightRadiusSlider, &QSlider::valueChanged,
+        [engine](int value)
+        {
+            engine->post(
+                [engine, value]()
+                {
+                    Settings &settings                 = Settings::getInstance();
+                    settings.lightSettings.lightRadius = value / 100.0f;
+                    for (auto &lightSource : engine->getLightSources())
+                    {
+                        if (lightSource->isOrbiting())
+                            lightSource->setRadius(settings.lightSettings.lightRadius);
+                    }
+                }
+            );
+        }
+    );
+
+    QLabel *smallLightsLabel       = new QLabel("Small Lights");
+    QComboBox *smallLightsComboBox = new QComboBox();
+    for (int count : {0, 64, 128, 256})
+    {
+        smallLightsComboBox->addItem(QString::number(count), count);
+    }
+    smallLightsComboBox->setCurrentIndex(
+        smallLightsComboBox->findData(Settings::getInstance().lightSettings.smallLightCount)
+    );
+    lightSettingsLayout->addWidget(smallLightsLabel);
+    lightSettingsLayout->addWidget(smallLightsComboBox);
+    connect(
+        smallLightsComboBox, qOverload<int>(&QComboBox::currentIndexChanged),
+        [engine, smallLightsComboBox](int index)
+        {
+            const int count = smallLightsComboBox->itemData(index).toInt();
+            engine->post(
+                [engine, count]()
+                {
+                    Settings &settings                     = Settings::getInstance();
+                    settings.lightSettings.smallLightCount = count;
+
+                    // The orbiting lights stay, the static ones are replaced
+                    const auto lightSources = engine->getLightSources();
+                    engine->clearLightSources();
+                    for (const auto &lightSource : lightSources)
+                    {
+                        if (lightSource->isOrbiting())
+                            engine->addLightSource(lightSource);
+                    }
+                    for (const auto &lightSource : LightSceneUtils::createSmallLights(
+                             count, settings.lightSettings.smallLightRadius, settings.lightSettings.orbitCenter.z()
+                         ))
+                    {
+                        engine->addLightSource(lightSource);
+                    }
+                }
+            );
         }
     );
 
@@ -502,6 +948,8 @@ void MainWindow::setupEngine(
     auto lightSource2 = QSharedPointer<LightSource>(new LightSource());
     lightSource->setPosition(QVector3D(-0.5, -0.5, -0.5));
     lightSource2->setPosition(QVector3D(0.5, 0.5, 0.5));
+    lightSource->setRadius(settings.lightSettings.lightRadius);
+    lightSource2->setRadius(settings.lightSettings.lightRadius);
     texture = QSharedPointer<QImage>(new QImage("textures/testTexture1.jpg"));
     scene->addItem(engine);
     QSharedPointer<QGraphicsEngineDrawable> drawable = QSharedPointer<QGraphicsEngineDrawable>(bezierSurface);
@@ -527,7 +975,14 @@ void MainWindow::setupEngine(
     engine->addLightSource(lightSource);
     engine->addLightSource(lightSource);
     engine->addLightSource(lightSource2);
-    engine->draw();
+    for (const auto &smallLight : LightSceneUtils::createSmallLights(
+             settings.lightSettings.smallLightCount, settings.lightSettings.smallLightRadius,
+             settings.lightSettings.orbitCenter.z()
+         ))
+    {
+        engine->addLightSource(smallLight);
+    }
+    engine->requestFrame();
     QSharedPointer<QImage> normalMap = nullptr;
 
     bezierSurface->setTexture(texture);
@@ -5,7 +5,10 @@
 #include "geometry/Mesh.h"
 #include "geometry/Triangle.h"
 #include "models/DrawData.h"
+#include "models/ShadowMap.h"
+#include "settings/Settings.h"
 #include <QFile>
+#include <QHash>
 #include <QImageReader>
 #include <QMatrix4x4>
 #include <QRegularExpression>
@@ -14,63 +17,245 @@
 #include <QtConcurrent>
 #include <algorithm>
 #include <cmath>
+#include <numeric>
 #include <qtconcurrentmap.h>
 
-[[maybe_unused]] Mesh::Mesh(const QVector<Triangle> &triangles)
+[[maybe_unused]] Mesh::Mesh(const VertexBuffer &vertices, const QVector<quint32> &indices)
 {
-    _triangles = triangles;
+    _vertices = vertices;
+    _indices  = indices;
     sortTrianglesByDepth();
 }
 
-[[maybe_unused]] Mesh::Mesh(QVector<Triangle> &&triangles)
+[[maybe_unused]] Mesh::Mesh(VertexBuffer &&vertices, QVector<quint32> &&indices)
 {
-    _triangles = qMove(triangles);
+    _vertices = qMove(vertices);
+    _indices  = qMove(indices);
     sortTrianglesByDepth();
 }
 
-[[maybe_unused]] QVector<Triangle> Mesh::getTriangles() const { return _triangles; }
-
 [[maybe_unused]] Mesh Mesh::create2dTessellation(const int tessellationLevel)
 {
-    return Mesh(create2dTessellationTriangles(tessellationLevel));
+    VertexBuffer vertices;
+    QVector<quint32> indices;
+    create2dTessellationGrid(tessellationLevel, vertices, indices);
+    return Mesh(qMove(vertices), qMove(indices));
 }
 
-QVector<Triangle> Mesh::create2dTessellationTriangles(const int tessellationLevel)
+void Mesh::create2dTessellationGrid(const int tessellationLevel, VertexBuffer &vertices, QVector<quint32> &indices)
 {
-    QVector<Triangle> triangles;
     int tessellationLevelX = std::ceil(std::sqrt(tessellationLevel));
     int tessellationLevelY = std::ceil(std::sqrt(tessellationLevel));
 
+    // Grid points are shared by up to six triangles, so they are created once and referenced by index
+    vertices.clear();
+    vertices.reserve((tessellationLevelX + 1) * (tessellationLevelY + 1));
+    for (int x = 0; x <= tessellationLevelX; x++)
+    {
+        for (int y = 0; y <= tessellationLevelY; y++)
+        {
+            vertices.append(QVector3D(x / (float)tessellationLevelX, y / (float)tessellationLevelY, 0));
+        }
+    }
+
+    auto gridIndex = [tessellationLevelY](int x, int y)
+    {
+        return static_cast<quint32>(x * (tessellationLevelY + 1) + y);
+    };
+
+    indices.clear();
+    indices.reserve(tessellationLevelX * tessellationLevelY * 6);
     for (int x = 0; x < tessellationLevelX; x++)
     {
         for (int y = 0; y < tessellationLevelY; y++)
         {
-            Vertex a(QVector3D(x / (float)tessellationLevelX, y / (float)tessellationLevelY, 0));
-            Vertex b(QVector3D((x + 1) / (float)tessellationLevelX, y / (float)tessellationLevelY, 0));
-            Vertex c(QVector3D(x / (float)tessellationLevelX, (y + 1) / (float)tessellationLevelY, 0));
-            Vertex d(QVector3D((x + 1) / (float)tessellationLevelX, (y + 1) / (float)tessellationLevelY, 0));
+            const quint32 a = gridIndex(x, y);
+            const quint32 b = gridIndex(x + 1, y);
+            const quint32 c = gridIndex(x, y + 1);
+            const quint32 d = gridIndex(x + 1, y + 1);
 
-            triangles.push_back(Triangle(a, b, c));
-            triangles.push_back(Triangle(b, c, d));
+            indices << a << b << c;
+            indices << b << c << d;
         }
     }
-
-    return triangles;
 }
 
 void Mesh::draw(DrawData &drawData)
 {
     QMutexLocker locker(&_mutex);
+    Settings &settings = Settings::getInstance();
     drawData.texture   = _texture;
     drawData.normalMap = _normalMap;
 
+    if (drawData.gBuffer)
+        drawData.materialIndex = drawData.gBuffer->addMaterial({_texture, _normalMap, drawData.brushColor});
+
+    assembleTriangles(drawData);
+
+    // Lights move independently of the geometry, so the vertex colors are redone every frame
+    if (drawData.shadingContext.perVertexLighting)
+        _vertices.updateVertexLighting(drawData.shadingContext);
+
+    if (drawData.visibilityBuffer)
+        resolveVisibility(drawData);
+    else
+        rasterizeTiles(drawData);
+
+    if (settings.triangleSettings.debugDraw)
+        drawVertices(drawData);
+}
+
+void Mesh::rasterizeTiles(DrawData &drawData)
+{
+    // Every tile is owned by a single worker, triangles inside a tile keep the mesh order
+    const bool useHiZ = Settings::getInstance().rasterizerSettings.hierarchicalZ;
     QtConcurrent::blockingMap(
-        _triangles,
-        [&drawData](Triangle &triangle)
+        drawData.tileGrid.getTiles(),
+        [this, &drawData, useHiZ](Tile &tile)
         {
-            triangle.draw(drawData);
+            qint64 hiZTested   = 0;
+            qint64 hiZRejected = 0;
+            for (const int triangleIndex : tile.triangleIndices)
+            {
+                const AssembledTriangle &assembled = _assembledTriangles[triangleIndex];
+                const bool needsClipping           = assembled.visibility == PrimitiveVisibility::NeedsClipping;
+                if (!useHiZ)
+                {
+                    getTriangle(triangleIndex).rasterize(drawData, tile.rect, needsClipping);
+                    continue;
+                }
+
+                const QRect overlap = assembled.screenBounds.intersected(tile.rect);
+                ++hiZTested;
+                if (drawData.hiZBuffer.isOccluded(drawData.zBuffer, overlap, assembled.nearestDepth))
+                {
+                    ++hiZRejected;
+                    continue;
+                }
+
+                getTriangle(triangleIndex).rasterize(drawData, tile.rect, needsClipping);
+                drawData.hiZBuffer.invalidate(overlap);
+            }
+            if (hiZTested > 0)
+                drawData.hiZBuffer.addCounts(hiZTested, hiZRejected);
+
+            // While the tile is still in cache, before anything is drawn over this mesh
+            drawData.canvas.resolveSamples(tile.rect);
+        }
+    );
+}
+
+void Mesh::resolveVisibility(DrawData &drawData)
+{
+    // Pass 1: any thread may write any pixel, the visibility buffer keeps the nearest fragment per pixel.
+    // The setup pass 2 needs is computed here as well, once per triangle instead of once per pixel it wins.
+    _resolveSetups.resize(getTriangleCount());
+    QtConcurrent::blockingMap(
+        _visibleTriangles,
+        [this, &drawData](const int triangleIndex)
+        {
+            const bool needsClipping =
+                _assembledTriangles[triangleIndex].visibility == PrimitiveVisibility::NeedsClipping;
+            const Triangle triangle = getTriangle(triangleIndex);
+            triangle.rasterizeVisibility(drawData, triangleIndex, needsClipping);
+            _resolveSetups[triangleIndex] = triangle.prepareResolve(drawData);
+        }
+    );
+
+    // Pass 2: rows are independent, every covered pixel is shaded once by the triangle that won it
+    const QRect bounds = _visibleBounds.intersected(QRect(0, 0, drawData.canvas.width(), drawData.canvas.height()));
+    if (bounds.isEmpty())
+        return;
+
+    _resolveRows.resize(bounds.height());
+    std::iota(_resolveRows.begin(), _resolveRows.end(), bounds.top());
+
+    Settings &settings = Settings::getInstance();
+    QtConcurrent::blockingMap(
+        _resolveRows,
+        [this, &drawData, &settings, &bounds](const int y)
+        {
+            VisibilityBuffer &visibilityBuffer = *drawData.visibilityBuffer;
+            for (int x = bounds.left(); x <= bounds.right(); ++x)
+            {
+                const VisibilityBuffer::Word word = visibilityBuffer.take(x, y);
+                if (word == VisibilityBuffer::Empty)
+                    continue;
+
+                const int triangleIndex = static_cast<int>(VisibilityBuffer::unpackPrimitiveId(word));
+                getTriangle(triangleIndex).resolveFragment(drawData, settings, _resolveSetups[triangleIndex], x, y);
+            }
+        }
+    );
+}
+
+void Mesh::drawVertices(DrawData &drawData) const
+{
+    for (int i = 0; i < _vertices.size(); i++)
+    {
+        _vertices.getVertex(i).draw(drawData);
+    }
+}
+
+void Mesh::assembleTriangles(DrawData &drawData)
+{
+    const RasterizerSettings &settings = Settings::getInstance().rasterizerSettings;
+
+    const int width          = drawData.canvas.width();
+    const int height         = drawData.canvas.height();
+    const bool cullBackFaces = settings.backFaceCulling && !_twoSided;
+    const int guardBand      = settings.guardBand;
+
+    // Every unique vertex is brought to screen space once, triangles only gather the three they index
+    _vertices.updateScreenVertices(width, height);
+    _assembledTriangles.resize(getTriangleCount());
+
+    // Classification is independent per triangle, only binning below has to stay serial
+    QtConcurrent::blockingMap(
+        _assembledTriangles,
+        [this, width, height, cullBackFaces, guardBand](AssembledTriangle &assembled)
+        {
+            const Triangle triangle = getTriangle(static_cast<int>(&assembled - _assembledTriangles.data()));
+
+            assembled.screenBounds = triangle.getScreenBounds();
+            assembled.nearestDepth = triangle.getNearestDepth();
+            assembled.visibility   = triangle.classify(width, height, assembled.screenBounds, cullBackFaces, guardBand);
         }
     );
+
+    RenderStats &stats = drawData.stats;
+    stats.trianglesSubmitted += getTriangleCount();
+
+    drawData.tileGrid.clearBins();
+    _visibleTriangles.resize(0);
+    _visibleBounds = QRect();
+    for (int i = 0; i < _assembledTriangles.size(); i++)
+    {
+        const AssembledTriangle &assembled = _assembledTriangles[i];
+        switch (assembled.visibility)
+        {
+        case PrimitiveVisibility::BackFacing:
+            stats.backFacesCulled++;
+            continue;
+        case PrimitiveVisibility::OutsideViewport:
+            stats.viewportRejected++;
+            continue;
+        case PrimitiveVisibility::NeedsClipping:
+            stats.guardBandClipped++;
+            break;
+        case PrimitiveVisibility::Visible:
+            break;
+        }
+
+        if (drawData.visibilityBuffer)
+        {
+            _visibleTriangles.append(i);
+            _visibleBounds = _visibleBounds.united(assembled.screenBounds);
+            continue;
+        }
+
+        drawData.tileGrid.binTriangle(i, assembled.screenBounds);
+    }
 }
 
 void Mesh::transform(QMatrix4x4 &matrix)
@@ -84,34 +269,43 @@ void Mesh::transform(QMatrix4x4 &matrix)
 
     _modelMatrix = translateBack * matrix * translateToOrigin;
 
-    QtConcurrent::blockingMap(
-        _triangles,
-        [&](Triangle &triangle)
-        {
-            triangle.transform(_modelMatrix);
-        }
-    );
+    _vertices.transform(_modelMatrix);
 
     sortTrianglesByDepth();
 }
 
+void Mesh::castShadow(ShadowMap &shadowMap)
+{
+    QMutexLocker locker(&_mutex);
+    shadowMap.addCaster(_vertices.getPositionsTransformed(), _indices);
+}
+
 void Mesh::sortTrianglesByDepth()
 {
+    const int triangleCount = getTriangleCount();
+
+    QVector<float> depths(triangleCount);
+    QVector<int> order(triangleCount);
+    for (int i = 0; i < triangleCount; i++)
+    {
+        depths[i] = getTriangle(i).getNearestDepth();
+        order[i]  = i;
+    }
+
     std::sort(
-        _triangles.begin(), _triangles.end(),
-        [](const Triangle &a, const Triangle &b)
+        order.begin(), order.end(),
+        [&depths](int a, int b)
         {
-            float aDepth = std::max(
-                {a.getA().getPositionTransformed().z(), a.getB().getPositionTransformed().z(),
-                 a.getC().getPositionTransformed().z()}
-            );
-            float bDepth = std::max(
-                {b.getA().getPositionTransformed().z(), b.getB().getPositionTransformed().z(),
-                 b.getC().getPositionTransformed().z()}
-            );
-            return aDepth > bDepth;
+            return depths[a] > depths[b];
         }
     );
+
+    QVector<quint32> sortedIndices(_indices.size());
+    for (int i = 0; i < triangleCount; i++)
+    {
+        std::copy_n(_indices.constData() + 3 * order[i], 3, sortedIndices.data() + 3 * i);
+    }
+    _indices.swap(sortedIndices);
 }
 
 void Mesh::readFromFile(const QString &path)
@@ -119,7 +313,8 @@ void Mesh::readFromFile(const QString &path)
     QMutexLocker locker(&_mutex);
 
     // Clear existing data
-    _triangles.clear();
+    _vertices.clear();
+    _indices.clear();
 
     // Containers for .obj data
     QVector<QVector3D> positions;
@@ -136,6 +331,9 @@ void Mesh::readFromFile(const QString &path)
 
     QTextStream in(&file);
 
+    // Corners with the same position/texture/normal triple share one vertex
+    QHash<QString, quint32> vertexIndices;
+
     while (!in.atEnd())
     {
         QString line = in.readLine().trimmed();
@@ -167,9 +365,15 @@ void Mesh::readFromFile(const QString &path)
             if (tokens.size() < 4)
                 continue; // Not enough vertices for a triangle
 
-            QVector<Vertex> faceVertices;
             for (int i = 1; i <= 3; ++i)
             {
+                const auto existing = vertexIndices.constFind(tokens[i]);
+                if (existing != vertexIndices.constEnd())
+                {
+                    _indices.append(existing.value());
+                    continue;
+                }
+
                 QStringList indices = tokens[i].split('/');
 
                 int posIndex  = indices[0].toInt() - 1;
@@ -181,16 +385,10 @@ void Mesh::readFromFile(const QString &path)
                 float u            = texIndex >= 0 ? texCoords[texIndex].x() : 0.0f;
                 float v            = texIndex >= 0 ? texCoords[texIndex].y() : 0.0f;
 
-                Vertex vertex(position, normal);
-                vertex.setU(u);
-                vertex.setV(v);
-
-                faceVertices.append(vertex);
+                const quint32 vertexIndex = _vertices.append(position, normal, u, v);
+                vertexIndices.insert(tokens[i], vertexIndex);
+                _indices.append(vertexIndex);
             }
-
-            // Create a triangle and add it to the mesh
-            Triangle triangle(faceVertices[0], faceVertices[1], faceVertices[2]);
-            _triangles.append(triangle);
         }
     }
 
@@ -202,13 +400,11 @@ void Mesh::readFromFile(const QString &path)
     QVector3D center(0.0f, 0.0f, 0.0f);
     int vertexCount = 0;
 
-    for (const Triangle &triangle : _triangles)
+    // Weighted by corners, like the triangle soup the mesh is loaded from
+    for (const quint32 index : _indices)
     {
-        for (const Vertex &vertex : {triangle.getA(), triangle.getB(), triangle.getC()})
-        {
-            center += vertex.getPositionOriginal();
-            ++vertexCount;
-        }
+        center += _vertices.getPositions()[index];
+        ++vertexCount;
     }
 
     if (vertexCount > 0)
@@ -222,37 +418,52 @@ void Mesh::readFromFile(const QString &path)
 }
 void Mesh::calculateTangents()
 {
-    for (Triangle &triangle : _triangles)
+    QVector<QVector3D> tangents(_vertices.size());
+    QVector<QVector3D> bitangents(_vertices.size());
+
+    const QVector<QVector3D> &positions = _vertices.getPositions();
+    const QVector<QVector2D> &uvs       = _vertices.getUvs();
+
+    for (int i = 0; i + 2 < _indices.size(); i += 3)
     {
-        Vertex &v0 = triangle.getA();
-        Vertex &v1 = triangle.getB();
-        Vertex &v2 = triangle.getC();
+        const quint32 i0 = _indices[i];
+        const quint32 i1 = _indices[i + 1];
+        const quint32 i2 = _indices[i + 2];
+
+        QVector3D deltaPos1 = positions[i1] - positions[i0];
+        QVector3D deltaPos2 = positions[i2] - positions[i0];
 
-        QVector3D deltaPos1 = v1.getPositionOriginal() - v0.getPositionOriginal();
-        QVector3D deltaPos2 = v2.getPositionOriginal() - v0.getPositionOriginal();
+        QVector2D deltaUV1 = uvs[i1] - uvs[i0];
+        QVector2D deltaUV2 = uvs[i2] - uvs[i0];
 
-        QVector2D deltaUV1 = QVector2D(v1.getU(), v1.getV()) - QVector2D(v0.getU(), v0.getV());
-        QVector2D deltaUV2 = QVector2D(v2.getU(), v2.getV()) - QVector2D(v0.getU(), v0.getV());
+        // Faces without a usable UV mapping would spread NaNs to every vertex they share
+        const float determinant = deltaUV1.x() * deltaUV2.y() - deltaUV1.y() * deltaUV2.x();
+        if (determinant == 0)
+            continue;
 
-        float r             = 1.0f / (deltaUV1.x() * deltaUV2.y() - deltaUV1.y() * deltaUV2.x());
+        float r             = 1.0f / determinant;
         QVector3D tangent   = (deltaPos1 * deltaUV2.y() - deltaPos2 * deltaUV1.y()) * r;
         QVector3D bitangent = (deltaPos2 * deltaUV1.x() - deltaPos1 * deltaUV2.x()) * r;
 
-        // Set the tangents in the vertices
-        v0.setUTangentOriginal(tangent);
-        v1.setUTangentOriginal(tangent);
-        v2.setUTangentOriginal(tangent);
+        // Accumulated over the faces sharing the vertex
+        for (const quint32 index : {i0, i1, i2})
+        {
+            tangents[index] += tangent;
+            bitangents[index] += bitangent;
+        }
+    }
 
-        v0.setVTangentOriginal(bitangent);
-        v1.setVTangentOriginal(bitangent);
-        v2.setVTangentOriginal(bitangent);
+    for (int i = 0; i < _vertices.size(); i++)
+    {
+        _vertices.setUTangent(i, tangents[i].normalized());
+        _vertices.setVTangent(i, bitangents[i].normalized());
     }
 }
 void Mesh::normalize()
 {
     QMutexLocker locker(&_mutex);
 
-    if (_triangles.isEmpty())
+    if (_vertices.size() == 0)
         return;
 
     // Initialize min and max values
@@ -264,19 +475,15 @@ void Mesh::normalize()
     );
 
     // Find min and max coordinates
-    for (const Triangle &triangle : _triangles)
+    for (const QVector3D &pos : _vertices.getPositions())
     {
-        for (const Vertex &vertex : {triangle.getA(), triangle.getB(), triangle.getC()})
-        {
-            const QVector3D &pos = vertex.getPositionOriginal();
-            minCoords.setX(std::min(minCoords.x(), pos.x()));
-            minCoords.setY(std::min(minCoords.y(), pos.y()));
-            minCoords.setZ(std::min(minCoords.z(), pos.z()));
-
-            maxCoords.setX(std::max(maxCoords.x(), pos.x()));
-            maxCoords.setY(std::max(maxCoords.y(), pos.y()));
-            maxCoords.setZ(std::max(maxCoords.z(), pos.z()));
-        }
+        minCoords.setX(std::min(minCoords.x(), pos.x()));
+        minCoords.setY(std::min(minCoords.y(), pos.y()));
+        minCoords.setZ(std::min(minCoords.z(), pos.z()));
+
+        maxCoords.setX(std::max(maxCoords.x(), pos.x()));
+        maxCoords.setY(std::max(maxCoords.y(), pos.y()));
+        maxCoords.setZ(std::max(maxCoords.z(), pos.z()));
     }
 
     // Compute the size of the bounding box
@@ -292,19 +499,29 @@ void Mesh::normalize()
     float scale = 1.0f / maxSize;
 
     // Normalize vertices
-    for (Triangle &triangle : _triangles)
+    for (int i = 0; i < _vertices.size(); i++)
     {
-        for (Vertex *vertex : {&triangle.getA(), &triangle.getB(), &triangle.getC()})
-        {
-            // Translate to origin
-            QVector3D pos = vertex->getPositionOriginal() - minCoords;
+        // Translate to origin
+        QVector3D pos = _vertices.getPositions()[i] - minCoords;
 
-            // Scale to [0, 1]
-            pos *= scale;
+        // Scale to [0, 1]
+        pos *= scale;
 
-            // Update the vertex positions
-            vertex->setPositionOriginal(pos);
-            vertex->setPositionTransformed(pos);
-        }
+        // Update the vertex positions
+        _vertices.setPosition(i, pos);
     }
 }
+
+QSharedPointer<Texture> Mesh::createTexture(const QSharedPointer<QImage> &image)
+{
+    if (!image || image->isNull())
+        return nullptr;
+    return QSharedPointer<Texture>::create(*image, Settings::getInstance().shadingSettings.textureLayout);
+}
+
+QSharedPointer<NormalMap> Mesh::createNormalMap(const QSharedPointer<QImage> &image)
+{
+    if (!image || image->isNull())
+        return nullptr;
+    return QSharedPointer<NormalMap>::create(*image, Settings::getInstance().shadingSettings.textureLayout);
+}
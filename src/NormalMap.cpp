@@ -0,0 +1,129 @@
+//
+// Created by wookie on 11/25/24.
+//
+
+#include "graphics/NormalMap.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
+
+NormalMap::NormalMap(const QImage &image, TextureLayout layout) : _layout(layout)
+{
+    const QImage converted = image.convertToFormat(QImage::Format_ARGB32);
+
+    auto decode = [](int channel)
+    {
+        return static_cast<float>(channel) / 127.5f - 1.0f;
+    };
+
+    MipLevel base{TexelGrid::create(layout, converted.width(), converted.height()), {}};
+    base.normals.resize(base.grid.storageSize);
+    for (int y = 0; y < base.grid.height; ++y)
+    {
+        const QRgb *source = reinterpret_cast<const QRgb *>(converted.constScanLine(y));
+        for (int x = 0; x < base.grid.width; ++x)
+        {
+            base.normals[base.grid.index(layout, x, y)] =
+                QVector3D(decode(qRed(source[x])), decode(qGreen(source[x])), decode(qBlue(source[x]))).normalized();
+        }
+    }
+    _levels.append(std::move(base));
+
+    buildMipChain();
+}
+
+void NormalMap::buildMipChain()
+{
+    while (_levels.last().grid.width > 1 || _levels.last().grid.height > 1)
+    {
+        const MipLevel &parent     = _levels.last();
+        const TexelGrid &source    = parent.grid;
+        const TextureLayout layout = _layout;
+        MipLevel level{TexelGrid::create(layout, std::max(1, source.width / 2), std::max(1, source.height / 2)), {}};
+        level.normals.resize(level.grid.storageSize);
+
+        QVector<int> rows(level.grid.height);
+        std::iota(rows.begin(), rows.end(), 0);
+
+        // Averaged normals are renormalized so every level stores unit vectors
+        QVector3D *normals = level.normals.data();
+        QtConcurrent::blockingMap(
+            rows,
+            [layout, &parent, &source, &level, normals](const int y)
+            {
+                const int y0 = std::min(2 * y, source.height - 1);
+                const int y1 = std::min(2 * y + 1, source.height - 1);
+                for (int x = 0; x < level.grid.width; ++x)
+                {
+                    const int x0 = std::min(2 * x, source.width - 1);
+                    const int x1 = std::min(2 * x + 1, source.width - 1);
+
+                    const QVector3D sum = parent.normals[source.index(layout, x0, y0)] +
+                                          parent.normals[source.index(layout, x1, y0)] +
+                                          parent.normals[source.index(layout, x0, y1)] +
+                                          parent.normals[source.index(layout, x1, y1)];
+
+                    // Opposite normals cancel out, such a texel falls back to the unperturbed surface normal
+                    normals[level.grid.index(layout, x, y)] = sum.isNull() ? QVector3D(0, 0, 1) : sum.normalized();
+                }
+            }
+        );
+
+        _levels.append(std::move(level));
+    }
+}
+
+QVector3D NormalMap::sample(float u, float v, float lod, TextureFilter filter) const
+{
+    switch (_layout)
+    {
+    case TextureLayout::Tiled:
+        return sampleLayout<TextureLayout::Tiled>(u, v, lod, filter);
+    case TextureLayout::Morton:
+        return sampleLayout<TextureLayout::Morton>(u, v, lod, filter);
+    case TextureLayout::RowMajor:
+        break;
+    }
+    return sampleLayout<TextureLayout::RowMajor>(u, v, lod, filter);
+}
+
+template <TextureLayout Layout>
+QVector3D NormalMap::sampleLayout(float u, float v, float lod, TextureFilter filter) const
+{
+    switch (filter)
+    {
+    case TextureFilter::Nearest:
+    {
+        const MipLevel &level = _levels[nearestLevel(lod)];
+        return level.normals[level.grid.nearest<Layout>(u, v)];
+    }
+    case TextureFilter::Bilinear:
+        return sampleBilinear<Layout>(_levels[nearestLevel(lod)], u, v);
+    case TextureFilter::Trilinear:
+        break;
+    }
+
+    const int lower = std::clamp(static_cast<int>(lod), 0, static_cast<int>(_levels.size()) - 1);
+    const float t   = lod - static_cast<float>(lower);
+
+    const QVector3D normal = sampleBilinear<Layout>(_levels[lower], u, v);
+    if (t <= 0.0f || lower + 1 >= _levels.size())
+        return normal;
+
+    return normal + (sampleBilinear<Layout>(_levels[lower + 1], u, v) - normal) * t;
+}
+
+int NormalMap::nearestLevel(float lod) const
+{
+    return std::clamp(static_cast<int>(lod + 0.5f), 0, static_cast<int>(_levels.size()) - 1);
+}
+
+template <TextureLayout Layout>
+QVector3D NormalMap::sampleBilinear(const MipLevel &level, float u, float v)
+{
+    const BilinearFootprint footprint = level.grid.bilinear<Layout>(u, v);
+
+    const QVector3D *normals = level.normals.constData();
+    return footprint.w00 * normals[footprint.i00] + footprint.w01 * normals[footprint.i01] +
+           footprint.w10 * normals[footprint.i10] + footprint.w11 * normals[footprint.i11];
+}
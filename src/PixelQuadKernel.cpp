@@ -0,0 +1,157 @@
+//
+// Created by wookie on 11/17/24.
+//
+
+#include "graphics/PixelQuadKernel.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+QuadSetup
+PixelQuadKernel::createSetup(const std::array<VertexStruct, 3> &vertices, bool withIrradiance, bool withTangents)
+{
+    // Optional attributes sit at the end, so the interpolated set is always a prefix
+    QuadSetup setup;
+    setup.attributeCount = withTangents ? QuadAttributeCount : withIrradiance ? QuadUTangentX : QuadIrradianceR;
+
+    for (int i = 0; i < 3; i++)
+    {
+        const VertexStruct &vertex = vertices[i];
+
+        setup.attributes[QuadZ][i]       = vertex.z;
+        setup.attributes[QuadPosX][i]    = vertex.pos.x();
+        setup.attributes[QuadPosY][i]    = vertex.pos.y();
+        setup.attributes[QuadPosZ][i]    = vertex.pos.z();
+        setup.attributes[QuadNormalX][i] = vertex.normal.x();
+        setup.attributes[QuadNormalY][i] = vertex.normal.y();
+        setup.attributes[QuadNormalZ][i] = vertex.normal.z();
+        setup.attributes[QuadU][i]       = vertex.u;
+        setup.attributes[QuadV][i]       = vertex.v;
+
+        setup.attributes[QuadIrradianceR][i] = vertex.irradiance.x();
+        setup.attributes[QuadIrradianceG][i] = vertex.irradiance.y();
+        setup.attributes[QuadIrradianceB][i] = vertex.irradiance.z();
+
+        setup.attributes[QuadUTangentX][i] = vertex.uTangent.x();
+        setup.attributes[QuadUTangentY][i] = vertex.uTangent.y();
+        setup.attributes[QuadUTangentZ][i] = vertex.uTangent.z();
+        setup.attributes[QuadVTangentX][i] = vertex.vTangent.x();
+        setup.attributes[QuadVTangentY][i] = vertex.vTangent.y();
+        setup.attributes[QuadVTangentZ][i] = vertex.vTangent.z();
+    }
+
+    return setup;
+}
+
+int PixelQuadKernel::processQuad(
+    const QuadSetup &setup, float w1, float w2, float w1StepX, float w2StepX, float *depthRow, int laneCount,
+    QuadFragments &fragments
+)
+{
+#if defined(__SSE2__)
+    // Partial quads at the right edge of a tile must not touch depth values owned by the neighbouring tile
+    if (laneCount == QuadWidth)
+        return processQuadSse(setup, w1, w2, w1StepX, w2StepX, depthRow, fragments);
+#endif
+    return processQuadScalar(setup, w1, w2, w1StepX, w2StepX, depthRow, laneCount, fragments);
+}
+
+int PixelQuadKernel::processQuadScalar(
+    const QuadSetup &setup, float w1, float w2, float w1StepX, float w2StepX, float *depthRow, int laneCount,
+    QuadFragments &fragments
+)
+{
+    static constexpr float laneOffsets[QuadWidth] = {0.0f, 1.0f, 2.0f, 3.0f};
+
+    int mask = 0;
+    for (int lane = 0; lane < laneCount; lane++)
+    {
+        const float l1 = w1 + laneOffsets[lane] * w1StepX;
+        const float l2 = w2 + laneOffsets[lane] * w2StepX;
+        const float l0 = 1.0f - l1 - l2;
+
+        fragments.w0[lane] = l0;
+        fragments.w1[lane] = l1;
+        fragments.w2[lane] = l2;
+
+        if (l0 < 0 || l1 < 0 || l2 < 0)
+            continue;
+
+        const float *z                    = setup.attributes[QuadZ];
+        const float depth                 = l0 * z[0] + l1 * z[1] + l2 * z[2];
+        fragments.attributes[QuadZ][lane] = depth;
+
+        if (depth < depthRow[lane])
+            continue;
+        depthRow[lane] = depth;
+        mask |= 1 << lane;
+    }
+
+    if (mask == 0)
+        return 0;
+
+    for (int attribute = QuadPosX; attribute < setup.attributeCount; attribute++)
+    {
+        const float *values = setup.attributes[attribute];
+        for (int lane = 0; lane < laneCount; lane++)
+        {
+            fragments.attributes[attribute][lane] =
+                fragments.w0[lane] * values[0] + fragments.w1[lane] * values[1] + fragments.w2[lane] * values[2];
+        }
+    }
+
+    return mask;
+}
+
+#if defined(__SSE2__)
+int PixelQuadKernel::processQuadSse(
+    const QuadSetup &setup, float w1, float w2, float w1StepX, float w2StepX, float *depthRow,
+    QuadFragments &fragments
+)
+{
+    const __m128 laneOffsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 zero        = _mm_setzero_ps();
+
+    const __m128 l1 = _mm_add_ps(_mm_set1_ps(w1), _mm_mul_ps(laneOffsets, _mm_set1_ps(w1StepX)));
+    const __m128 l2 = _mm_add_ps(_mm_set1_ps(w2), _mm_mul_ps(laneOffsets, _mm_set1_ps(w2StepX)));
+    const __m128 l0 = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), l1), l2);
+
+    _mm_store_ps(fragments.w0, l0);
+    _mm_store_ps(fragments.w1, l1);
+    _mm_store_ps(fragments.w2, l2);
+
+    // Written as "not less than zero" to match the scalar comparisons exactly, NaN included
+    const __m128 outside =
+        _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(l0, zero), _mm_cmplt_ps(l1, zero)), _mm_cmplt_ps(l2, zero));
+    if (_mm_movemask_ps(outside) == 0xF)
+        return 0;
+
+    auto interpolate = [&setup, &l0, &l1, &l2](int attribute) -> __m128
+    {
+        const float *values = setup.attributes[attribute];
+        return _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(l0, _mm_set1_ps(values[0])), _mm_mul_ps(l1, _mm_set1_ps(values[1]))),
+            _mm_mul_ps(l2, _mm_set1_ps(values[2]))
+        );
+    };
+
+    const __m128 depth = interpolate(QuadZ);
+    _mm_store_ps(fragments.attributes[QuadZ], depth);
+
+    const __m128 storedDepth = _mm_loadu_ps(depthRow);
+    const __m128 rejected    = _mm_or_ps(outside, _mm_cmplt_ps(depth, storedDepth));
+    const int mask           = ~_mm_movemask_ps(rejected) & 0xF;
+    if (mask == 0)
+        return 0;
+
+    const __m128 passed = _mm_andnot_ps(rejected, _mm_castsi128_ps(_mm_set1_epi32(-1)));
+    _mm_storeu_ps(depthRow, _mm_or_ps(_mm_and_ps(passed, depth), _mm_andnot_ps(passed, storedDepth)));
+
+    for (int attribute = QuadPosX; attribute < setup.attributeCount; attribute++)
+    {
+        _mm_store_ps(fragments.attributes[attribute], interpolate(attribute));
+    }
+
+    return mask;
+}
+#endif
@@ -0,0 +1,20 @@
+//
+// Created by wookie on 11/24/24.
+//
+
+#include "utils/PowerUtils.h"
+
+void PowerTable::build(int exponent, int size)
+{
+    Q_ASSERT(size >= 2);
+    if (exponent == _exponent && size == _values.size())
+        return;
+
+    _exponent = exponent;
+    _scale    = static_cast<float>(size - 1);
+    _values.resize(size);
+    for (int i = 0; i < size; i++)
+    {
+        _values[i] = PowerUtils::powInt(static_cast<float>(i) / _scale, exponent);
+    }
+}
@@ -5,29 +5,53 @@
 #include "models/DrawData.h"
 #include "qobject.h"
 #include "settings/Settings.h"
+#include "utils/DrawUtils.h"
+#include "utils/UpscaleUtils.h"
 #include "utils/VectorMovementUtils.h"
 #include <QColor>
-#include <QDateTime>
 #include <QMatrix4x4>
 #include <QMutex>
 #include <QPainter>
 #include <QPixmap>
 #include <QRandomGenerator>
 #include <QStyleOptionGraphicsItem>
-#include <QTimer>
 #include <QWidget>
+#include <algorithm>
+
+namespace
+{
+// The timer-driven loop advanced the orbits twice per 60 Hz frame, once before drawing and once after
+constexpr float OrbitStepsPerTick = 2.0f;
+// A published frame the GUI has not painted holds the next one back at most this long, a hidden view never paints
+constexpr unsigned long PresentTimeoutMs = 100;
+} // namespace
 
 QGraphicsEngine::QGraphicsEngine(int width, int height) : _width(width), _height(height)
 {
-    _qImage = QImage(_width, _height, QImage::Format_ARGB32);
-    _qImage.fill(Settings::getInstance().graphicsEngineSettings.backgroundColor);
+    _framebuffer.resize(_width, _height);
+    _framebuffer.fill(Settings::getInstance().graphicsEngineSettings.backgroundColor.rgba());
+    _framebuffer.resolve();
+    _frontImage = _framebuffer.toImage();
+    _upscaledImage = _frontImage.copy();
+    _gBuffer.resize(_width, _height);
+    _visibilityBuffer.resize(_width, _height);
 }
 
+QGraphicsEngine::~QGraphicsEngine() { stopRenderThread(); }
+
 QRectF QGraphicsEngine::boundingRect() const { return {0, 0, static_cast<qreal>(_width), static_cast<qreal>(_height)}; }
 
 void QGraphicsEngine::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
-    painter->drawImage(0, 0, _qImage);
+    {
+        QMutexLocker locker(&_presentMutex);
+        painter->drawImage(0, 0, _frontImage);
+    }
+
+    // The front image is on screen, the render thread may replace it
+    QMutexLocker locker(&_renderMutex);
+    _presentPending = false;
+    _renderCondition.wakeOne();
 }
 
 void QGraphicsEngine::testPixmap()
@@ -41,27 +65,32 @@ void QGraphicsEngine::testPixmap()
 
     QColor currentColor = colors[randomGen->bounded(colors.size())];
 
-    for (int x = 0; x < _width; x++)
+    for (int x = 0; x < _framebuffer.width(); x++)
     {
-        for (int y = 0; y < _height; y++)
+        for (int y = 0; y < _framebuffer.height(); y++)
         {
             if (randomGen->bounded(100) < 5)
             {
                 currentColor = colors[randomGen->bounded(colors.size())];
             }
 
-            _qImage.setPixelColor(x, y, currentColor);
+            _framebuffer.setPixel(x, y, currentColor);
         }
     }
 
-    update();
+    _framebuffer.resolve();
+    publishFrame();
 }
 
 int QGraphicsEngine::getWidth() const { return _width; }
 
 int QGraphicsEngine::getHeight() const { return _height; }
 
-QImage QGraphicsEngine::getQImage() const { return _qImage; }
+QImage QGraphicsEngine::getQImage() const
+{
+    QMutexLocker locker(&_presentMutex);
+    return _frontImage.copy();
+}
 
 void QGraphicsEngine::addDrawable(QSharedPointer<QGraphicsEngineDrawable> &drawable)
 {
@@ -69,51 +98,220 @@ void QGraphicsEngine::addDrawable(QSharedPointer<QGraphicsEngineDrawable> &drawa
     _drawables.append(drawable);
 }
 
-void QGraphicsEngine::clearDrawables() { _drawables.clear(); }
+void QGraphicsEngine::clearDrawables()
+{
+    QMutexLocker locker(&_drawMutex);
+    _drawables.clear();
+}
 
 void QGraphicsEngine::draw()
 {
+    applyPendingRotation();
+
+    QMutexLocker locker(&_drawMutex);
     Settings &settings = Settings::getInstance();
-    _qImage.fill(settings.graphicsEngineSettings.backgroundColor);
-    DrawData drawData(_qImage);
-    drawData.brushColor = settings.bezierSurfaceSettings.defaultColor;
-    for (QSharedPointer<LightSource> lightSource : _lightSources)
+
+    // Dynamic resolution renders a smaller canvas, the per-pixel targets follow it and the frame is upscaled
+    const float resolutionScale = _resolutionScaler.getScale();
+    const int canvasWidth       = std::max(1, qRound(static_cast<float>(_width) * resolutionScale));
+    const int canvasHeight      = std::max(1, qRound(static_cast<float>(_height) * resolutionScale));
+    if (canvasWidth != _framebuffer.width() || canvasHeight != _framebuffer.height())
     {
-        drawData.appendLightSource(*lightSource);
+        _framebuffer.resize(canvasWidth, canvasHeight);
+        _gBuffer.resize(canvasWidth, canvasHeight);
+        _visibilityBuffer.resize(canvasWidth, canvasHeight);
     }
 
-    //    QMutexLocker locker(&_drawMutex);
-    for (auto &drawable : _drawables)
+    // G-buffer and visibility buffer hold one fragment per pixel, and debug fills are inspected per pixel
+    const bool multisampled = settings.rasterizerSettings.multisampling != Multisampling::Off &&
+                              !settings.triangleSettings.debugDraw;
+    _framebuffer.setSampleCount(multisampled ? settings.rasterizerSettings.sampleCount() : 1);
+    _framebuffer.fill(settings.graphicsEngineSettings.backgroundColor.rgba());
+
+    // Reallocated only when the canvas or the tiling changes, cleared in place before anything is rasterized
+    const RasterizerSettings &rasterizerSettings = settings.rasterizerSettings;
+    const bool reallocated =
+        _renderTargets.resize(canvasWidth, canvasHeight, rasterizerSettings.tileSize, rasterizerSettings.hiZBlockSize);
+    DrawData drawData(_framebuffer, _renderTargets, _shadingContext);
+    drawData.brushColor            = settings.bezierSurfaceSettings.defaultColor;
+    drawData.resolutionScale       = resolutionScale;
+    drawData.stats.resolutionScale = resolutionScale;
+
+    // The shading context keeps pointers to the maps, so they are brought up to date first
+    const bool lit = !settings.triangleSettings.debugDraw && settings.lightSettings.isLightSourceEnabled;
+    if (settings.shadingSettings.shadows && lit)
+    {
+        for (auto &lightSource : _lightSources)
+        {
+            const bool rendered = lightSource->getShadowMap().update(
+                lightSource->getPosition(), lightSource->getDirection(), _drawables, settings.shadingSettings
+            );
+            drawData.stats.shadowMapsRendered += rendered ? 1 : 0;
+        }
+    }
+
+    // Debug fill colors are drawn unlit
+    drawData.shadingContext.build(
+        _lightSources, settings.lightSettings, settings.shadingSettings, !settings.triangleSettings.debugDraw,
+        _framebuffer.width(), _framebuffer.height()
+    );
+    drawData.stats.lightTileEntries = drawData.shadingContext.getLightGrid().getEntryCount();
+
+    // Debug drawing needs barycentrics per fragment, so it always runs forward.
+    // Per-vertex lighting leaves nothing to defer but a texture fetch.
+    // Overlays drawn with the surfaces go straight into the canvas, so frames showing them are never relit.
+    // Light markers are drawn after shading and leave both the G-buffer and the depth buffer alone.
+    const bool perVertex   = drawData.shadingContext.perVertexLighting;
+    const bool relightable = settings.shadingSettings.incrementalRelighting && !settings.triangleSettings.debugDraw &&
+                             !settings.bezierSurfaceSettings.showControlPoints && !perVertex && !multisampled;
+    // Relighting keeps the G-buffer of the last full frame, so it defers even when deferred shading is off
+    const bool deferred = (settings.shadingSettings.deferredShading || relightable) &&
+                          !settings.triangleSettings.debugDraw && !perVertex && !multisampled;
+
+    SurfaceState surfaceState = captureSurfaceState(settings);
+    if (relightable && _gBufferReusable && !reallocated && surfaceState == _surfaceState)
+    {
+        // Nothing the G-buffer depends on changed since it was filled, only the lighting is redone
+        drawData.gBuffer     = &_gBuffer;
+        drawData.stats.relit = true;
+    }
+    else
+    {
+        _renderTargets.clear();
+        if (deferred)
+        {
+            _gBuffer.clear();
+            drawData.gBuffer = &_gBuffer;
+        }
+
+        // Left clean by every resolve pass, so it needs no clearing here
+        if (settings.rasterizerSettings.resolveMode == ResolveMode::AtomicVisibility && !multisampled)
+            drawData.visibilityBuffer = &_visibilityBuffer;
+
+        for (auto &drawable : _drawables)
+        {
+            drawable->draw(drawData);
+        }
+
+        drawData.stats.hiZTested   = drawData.hiZBuffer.getTestedCount();
+        drawData.stats.hiZRejected = drawData.hiZBuffer.getRejectedCount();
+
+        _surfaceState    = std::move(surfaceState);
+        // Overlay pixels were punched out of the G-buffer, relighting it would leave holes where they were
+        _gBufferReusable = relightable && !_gBuffer.hasOverlays();
+    }
+
+    if (drawData.gBuffer)
     {
-        drawable->draw(drawData);
+        DrawUtils::shadeGBuffer(drawData);
     }
 
+    // The markers go over the shaded canvas, the G-buffer has to stay intact for the next relit frame
+    drawData.gBuffer = nullptr;
     for (auto &lightSource : _lightSources)
     {
         lightSource->draw(drawData);
     }
 
-    autoMoveLightSources();
+    _framebuffer.resolve();
+    {
+        QMutexLocker presentLocker(&_presentMutex);
+        _renderStats = drawData.stats;
+    }
+    publishFrame();
+}
+
+QGraphicsEngine::SurfaceState QGraphicsEngine::captureSurfaceState(const Settings &settings) const
+{
+    SurfaceState state;
+    state.drawables.reserve(_drawables.size());
+    state.versions.reserve(_drawables.size());
+    for (const auto &drawable : _drawables)
+    {
+        state.drawables.append(drawable.data());
+        state.versions.append(drawable->getSurfaceVersion());
+    }
 
-    update();
+    state.brushColor        = settings.bezierSurfaceSettings.defaultColor.rgba();
+    state.rasterizationMode = settings.rasterizerSettings.rasterizationMode;
+    state.resolveMode       = settings.rasterizerSettings.resolveMode;
+    state.backFaceCulling   = settings.rasterizerSettings.backFaceCulling;
+    return state;
+}
+
+void QGraphicsEngine::publishFrame()
+{
+    // Swapping the images is the whole publish, paint() holds the same mutex while it reads the front one.
+    // A scaled canvas is upscaled into a spare image of the view size first, which is swapped instead.
+    if (_framebuffer.width() == _width && _framebuffer.height() == _height)
+    {
+        QMutexLocker locker(&_presentMutex);
+        _framebuffer.swapImage(_frontImage);
+    }
+    else
+    {
+        UpscaleUtils::upscale(
+            _framebuffer.image(), _upscaledImage, Settings::getInstance().graphicsEngineSettings.upscaleFilter
+        );
+        QMutexLocker locker(&_presentMutex);
+        _frontImage.swap(_upscaledImage);
+    }
+
+    {
+        QMutexLocker locker(&_renderMutex);
+        _presentPending = true;
+    }
+
+    // QGraphicsItem is not a QObject, so the repaint is queued to the GUI thread through a context object
+    QMetaObject::invokeMethod(
+        &_presentContext,
+        [this]()
+        {
+            update();
+        },
+        Qt::QueuedConnection
+    );
 }
 
 void QGraphicsEngine::setRotationX(float rotationX)
 {
-    _rotationX = rotationX;
-    rotate(_rotationX, _rotationY, _rotationZ);
+    QMutexLocker locker(&_renderMutex);
+    _rotationX       = rotationX;
+    _rotationPending = true;
+    _renderCondition.wakeOne();
 }
 
 void QGraphicsEngine::setRotationY(float rotationY)
 {
-    _rotationY = rotationY;
-    rotate(_rotationX, _rotationY, _rotationZ);
+    QMutexLocker locker(&_renderMutex);
+    _rotationY       = rotationY;
+    _rotationPending = true;
+    _renderCondition.wakeOne();
 }
 
 void QGraphicsEngine::setRotationZ(float rotationZ)
 {
-    _rotationZ = rotationZ;
-    rotate(_rotationX, _rotationY, _rotationZ);
+    QMutexLocker locker(&_renderMutex);
+    _rotationZ       = rotationZ;
+    _rotationPending = true;
+    _renderCondition.wakeOne();
+}
+
+void QGraphicsEngine::applyPendingRotation()
+{
+    float x = 0;
+    float y = 0;
+    float z = 0;
+    {
+        QMutexLocker locker(&_renderMutex);
+        if (!_rotationPending)
+            return;
+        x                = _rotationX;
+        y                = _rotationY;
+        z                = _rotationZ;
+        _rotationPending = false;
+    }
+    rotate(x, y, z);
 }
 
 void QGraphicsEngine::rotate(float x, float y, float z)
@@ -143,21 +341,23 @@ void QGraphicsEngine::clearLightSources()
     _lightSources.clear();
 }
 
-void QGraphicsEngine::autoMoveLightSources()
+void QGraphicsEngine::autoMoveLightSources(int steps)
 {
     Settings &settings = Settings::getInstance();
 
-    QDateTime currentDateTime          = QDateTime::currentDateTime();
-    qint64 currentMSecsSinceEpoch      = currentDateTime.toMSecsSinceEpoch();
-    settings.lightSettings.orbitRadius = settings.lightSettings.sineCoeff * sin(currentMSecsSinceEpoch / 1000.0f) +
+    // The radius breathes with the simulation clock, pausing the animation pauses it as well
+    settings.lightSettings.orbitRadius = settings.lightSettings.sineCoeff * sin(_frameScheduler.getSimulationTime()) +
                                          settings.lightSettings.baseOrbitRadius;
 
     for (auto &lightSource : _lightSources)
     {
+        if (!lightSource->isOrbiting())
+            continue;
+
         QVector3D &position = lightSource->getPosition();
         VectorMovementUtils::moveAcrossCircle(
             position, settings.lightSettings.orbitCenter, settings.lightSettings.orbitRadius,
-            settings.lightSettings.orbitSpeed
+            settings.lightSettings.orbitSpeed * OrbitStepsPerTick * static_cast<float>(steps)
         );
         // Set direction as normalized vector from light source to orbit center
         lightSource->setDirection((settings.lightSettings.centerToPointAt - position).normalized());
@@ -166,63 +366,160 @@ void QGraphicsEngine::autoMoveLightSources()
 
 void QGraphicsEngine::setRotation(float x, float y, float z)
 {
-    _rotationX = x;
-    _rotationY = y;
-    _rotationZ = z;
-    rotate(_rotationX, _rotationY, _rotationZ);
+    QMutexLocker locker(&_renderMutex);
+    _rotationX       = x;
+    _rotationY       = y;
+    _rotationZ       = z;
+    _rotationPending = true;
+    _renderCondition.wakeOne();
 }
 
-void QGraphicsEngine::setupAnimationTimer()
+void QGraphicsEngine::startRenderThread()
 {
-    if (!_animationTimer)
-    {
-        _animationTimer = QSharedPointer<QTimer>::create();
-    }
+    if (_renderThread)
+        return;
 
-    if (_animationTimer->isActive())
     {
-        _animationTimer->stop();
-        _animationTimer->disconnect();
+        QMutexLocker locker(&_renderMutex);
+        _stopRequested  = false;
+        _frameRequested = true;
     }
-
-    QObject::connect(
-        _animationTimer.data(), &QTimer::timeout,
+    _renderThread.reset(QThread::create(
         [this]()
         {
-            this->autoMoveLightSources();
-            this->draw();
+            renderLoop();
         }
-    );
-    _animationTimer->start(1000 / 60);
+    ));
+    _renderThread->start();
 }
 
-void QGraphicsEngine::stopAnimation()
+void QGraphicsEngine::stopRenderThread()
 {
-    if (_animationTimer && _animationTimer->isActive())
+    if (!_renderThread)
+        return;
+
     {
-        _animationTimer->stop();
+        QMutexLocker locker(&_renderMutex);
+        _stopRequested = true;
+        _renderCondition.wakeOne();
     }
+    _renderThread->wait();
+    _renderThread.reset();
 }
 
-void QGraphicsEngine::startAnimation()
+void QGraphicsEngine::requestFrame()
+{
+    QMutexLocker locker(&_renderMutex);
+    _frameRequested = true;
+    _renderCondition.wakeOne();
+}
+
+void QGraphicsEngine::post(std::function<void()> change)
 {
-    if (_animationTimer && !_animationTimer->isActive())
+    // Before the thread starts the caller is the only one touching the scene
+    if (!_renderThread)
     {
-        _animationTimer->start(1000 / 60);
+        change();
+        return;
     }
+
+    QMutexLocker locker(&_renderMutex);
+    _pendingChanges.append(std::move(change));
+    _frameRequested = true;
+    _renderCondition.wakeOne();
 }
 
-void QGraphicsEngine::toggleAnimation()
+void QGraphicsEngine::renderLoop()
 {
-    if (_animationTimer)
+    _frameScheduler.start();
+    qint64 framesSkipped = 0;
+
+    while (true)
     {
-        if (_animationTimer->isActive())
+        bool animating = false;
+        int targetFps  = 0;
+        QVector<std::function<void()>> changes;
         {
-            stopAnimation();
+            QMutexLocker locker(&_renderMutex);
+            while (!_stopRequested && !_animating && !_frameRequested && !_rotationPending)
+            {
+                _renderCondition.wait(&_renderMutex);
+            }
+
+            // Back-pressure, the previous frame is still waiting for the GUI to paint it
+            while (!_stopRequested && _presentPending)
+            {
+                if (!_renderCondition.wait(&_renderMutex, PresentTimeoutMs))
+                {
+                    // Never painted, the next frame replaces it
+                    ++framesSkipped;
+                    break;
+                }
+            }
+
+            // Woken early by every rotation or request, so the delay is measured again each time
+            targetFps = Settings::getInstance().graphicsEngineSettings.targetFps;
+            qint64 delay = _frameScheduler.getFrameDelay(targetFps);
+            while (!_stopRequested && delay > 0)
+            {
+                _renderCondition.wait(&_renderMutex, static_cast<unsigned long>(delay));
+                delay = _frameScheduler.getFrameDelay(targetFps);
+            }
+            if (_stopRequested)
+                return;
+
+            animating       = _animating;
+            _frameRequested = false;
+            changes.swap(_pendingChanges);
         }
-        else
+
+        // Outside the lock, a change may rotate or request a frame itself
+        for (const auto &change : changes)
         {
-            startAnimation();
+            change();
         }
+
+        // The orbits advance in fixed steps, however fast the frames come
+        const int steps = _frameScheduler.beginFrame(targetFps, animating);
+        if (steps > 0)
+            autoMoveLightSources(steps);
+
+        draw();
+        _frameScheduler.endFrame();
+
+        bool relit = false;
+        {
+            QMutexLocker presentLocker(&_presentMutex);
+            _renderStats.frameTime        = _frameScheduler.getFrameTime();
+            _renderStats.averageFrameTime = _frameScheduler.getAverageFrameTime();
+            _renderStats.simulationSteps  = steps;
+            _renderStats.framesSkipped    = framesSkipped;
+            relit                         = _renderStats.relit;
+        }
+
+        // Relit frames rasterize nothing, their time says little about what the next full frame costs
+        const GraphicsEngineSettings &engineSettings = Settings::getInstance().graphicsEngineSettings;
+        if (!relit || !engineSettings.dynamicResolution)
+            _resolutionScaler.update(_frameScheduler.getFrameTime(), engineSettings);
     }
 }
+
+void QGraphicsEngine::stopAnimation()
+{
+    QMutexLocker locker(&_renderMutex);
+    _animating = false;
+}
+
+void QGraphicsEngine::startAnimation()
+{
+    QMutexLocker locker(&_renderMutex);
+    _animating = true;
+    _renderCondition.wakeOne();
+}
+
+void QGraphicsEngine::toggleAnimation()
+{
+    QMutexLocker locker(&_renderMutex);
+    _animating = !_animating;
+    _renderCondition.wakeOne();
+}
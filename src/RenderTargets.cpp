@@ -0,0 +1,32 @@
+//
+// Created by wookie on 11/28/24.
+//
+
+#include "models/RenderTargets.h"
+#include "utils/FillUtils.h"
+#include <limits>
+
+bool RenderTargets::resize(int width, int height, int tileSize, int hiZBlockSize)
+{
+    if (width == _width && height == _height && tileSize == _tileSize && hiZBlockSize == _hiZBlockSize)
+        return false;
+
+    Q_ASSERT(tileSize % hiZBlockSize == 0);
+    _width        = width;
+    _height       = height;
+    _tileSize     = tileSize;
+    _hiZBlockSize = hiZBlockSize;
+
+    // Shrinking keeps the capacity, only a larger canvas than ever before allocates
+    _depthStorage.resize(width * height);
+    _depth = _depthStorage.data();
+    _hiZBuffer.resize(width, height, hiZBlockSize);
+    _tileGrid.resize(width, height, tileSize);
+    return true;
+}
+
+void RenderTargets::clear()
+{
+    FillUtils::parallelFill(_depth, static_cast<qsizetype>(_width) * _height, -std::numeric_limits<float>::max());
+    _hiZBuffer.clear();
+}
@@ -0,0 +1,61 @@
+//
+// Created by wookie on 11/30/24.
+//
+
+#include "graphics/ResolutionScaler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Frames averaged at a new scale before it may change again
+constexpr int SettleFrames = 8;
+// Weight of the newest frame in the moving average
+constexpr double AverageWeight = 0.15;
+// The scale only grows while the average stays below this share of the budget, so it does not oscillate around it
+constexpr double Headroom = 0.8;
+// Growing is cautious, a scale too large for the budget costs a few slow frames before it shrinks again
+constexpr float MaxGrowth = 2.0f * ResolutionScaler::ScaleStep;
+// Below this the upscaled image is too blurry to be useful
+constexpr float MinScale = 0.25f;
+} // namespace
+
+bool ResolutionScaler::update(double frameTime, const GraphicsEngineSettings &settings)
+{
+    if (!settings.dynamicResolution)
+        return setScale(1.0f);
+
+    const float minScale = std::clamp(settings.minResolutionScale, MinScale, 1.0f);
+    const float maxScale = std::clamp(settings.maxResolutionScale, minScale, 1.0f);
+
+    _averageFrameTime =
+        _frameCount == 0 ? frameTime : _averageFrameTime + (frameTime - _averageFrameTime) * AverageWeight;
+    if (++_frameCount < SettleFrames || _averageFrameTime <= 0.0)
+        return setScale(std::clamp(_scale, minScale, maxScale));
+
+    const double budget = settings.frameTimeBudget;
+    float target        = _scale;
+    if (_averageFrameTime > budget)
+    {
+        target = _scale * static_cast<float>(std::sqrt(budget / _averageFrameTime));
+    }
+    else if (_averageFrameTime < budget * Headroom)
+    {
+        target = std::min(_scale + MaxGrowth, _scale * static_cast<float>(std::sqrt(budget / _averageFrameTime)));
+    }
+
+    // Rounded down both ways, a scale just over the budget shrinks and one just under it does not grow
+    target = std::floor(target / ScaleStep) * ScaleStep;
+    return setScale(std::clamp(target, minScale, maxScale));
+}
+
+bool ResolutionScaler::setScale(float scale)
+{
+    if (scale == _scale)
+        return false;
+
+    _scale            = scale;
+    _averageFrameTime = 0.0;
+    _frameCount       = 0;
+    return true;
+}
@@ -0,0 +1,214 @@
+//
+// Created by wookie on 11/23/24.
+//
+
+#include "models/ShadingContext.h"
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+
+void ShadingContext::build(
+    const QVector<QSharedPointer<LightSource>> &lightSources, const LightSettings &lightSettings,
+    const ShadingSettings &shadingSettings, bool lit, int width, int height
+)
+{
+    kd               = lightSettings.kdCoef;
+    ks               = lightSettings.ksCoef;
+    m                = lightSettings.m;
+    reflectorEnabled = lightSettings.isReflectorEnabled;
+    mCoeffReflector  = lightSettings.mCoeffReflector;
+    textureFilter    = shadingSettings.textureFilter;
+
+    _useSpecularTable  = useTable(shadingSettings, m);
+    _useReflectorTable = useTable(shadingSettings, mCoeffReflector);
+    if (_useSpecularTable)
+        _specularTable.build(m, shadingSettings.exponentTableSize);
+    if (_useReflectorTable)
+        _reflectorTable.build(mCoeffReflector, shadingSettings.exponentTableSize);
+
+    _lightCount = lit && lightSettings.isLightSourceEnabled ? lightSources.size() : 0;
+
+    const ShadingRate rate = shadingSettings.shadingRate;
+    const bool fewThreads  = QThread::idealThreadCount() <= shadingSettings.perVertexThreadThreshold;
+    perVertexLighting =
+        _lightCount > 0 && (rate == ShadingRate::PerVertex || (rate == ShadingRate::Automatic && fewThreads));
+
+    for (QVector<float> *component :
+         {&positionsX, &positionsY, &positionsZ, &directionsX, &directionsY, &directionsZ, &colorsR, &colorsG,
+          &colorsB, &radii})
+    {
+        component->resize(_lightCount);
+    }
+    shadowMaps.resize(shadingSettings.shadows ? _lightCount : 0);
+
+    for (int i = 0; i < _lightCount; i++)
+    {
+        LightSource &lightSource = *lightSources[i];
+        const QColor color       = lightSource.getColor();
+
+        positionsX[i]  = lightSource.getPosition().x();
+        positionsY[i]  = lightSource.getPosition().y();
+        positionsZ[i]  = lightSource.getPosition().z();
+        directionsX[i] = lightSource.getDirection().x();
+        directionsY[i] = lightSource.getDirection().y();
+        directionsZ[i] = lightSource.getDirection().z();
+        colorsR[i]     = color.redF();
+        colorsG[i]     = color.greenF();
+        colorsB[i]     = color.blueF();
+        radii[i]       = std::max(0.0f, lightSource.getRadius());
+    }
+    for (int i = 0; i < shadowMaps.size(); i++)
+    {
+        shadowMaps[i] = &lightSources[i]->getShadowMap();
+    }
+
+    if (shadingSettings.lightCulling && _lightCount > 0)
+    {
+        QVector<QRect> bounds(_lightCount);
+        for (int i = 0; i < _lightCount; i++)
+        {
+            bounds[i] = lightBounds(i, width, height);
+        }
+        _lightGrid.build(bounds, width, height, shadingSettings.lightTileSize);
+    }
+    else
+    {
+        _lightGrid.clear();
+    }
+}
+
+QVector3D ShadingContext::irradiance(const QVector3D &position, const QVector3D &normal) const
+{
+    float r = 0.0f;
+    float g = 0.0f;
+    float b = 0.0f;
+    for (int i = 0; i < _lightCount; i++)
+    {
+        addLight(i, position, normal, r, g, b);
+    }
+
+    return {r, g, b};
+}
+
+QVector3D ShadingContext::irradiance(const QVector3D &position, const QVector3D &normal, int x, int y) const
+{
+    if (_lightGrid.isEmpty() || !_lightGrid.contains(x, y))
+        return irradiance(position, normal);
+
+    int count         = 0;
+    const int *lights = _lightGrid.getTileLights(x, y, count);
+
+    float r = 0.0f;
+    float g = 0.0f;
+    float b = 0.0f;
+    for (int k = 0; k < count; k++)
+    {
+        addLight(lights[k], position, normal, r, g, b);
+    }
+
+    return {r, g, b};
+}
+
+void ShadingContext::addLight(
+    int i, const QVector3D &position, const QVector3D &normal, float &r, float &g, float &b
+) const
+{
+    // L points from the light towards the surface
+    float lx            = position.x() - positionsX[i];
+    float ly            = position.y() - positionsY[i];
+    float lz            = position.z() - positionsZ[i];
+    const float lLength = std::sqrt(lx * lx + ly * ly + lz * lz);
+
+    // Smooth window, 1 at the light and 0 from the radius on
+    float falloff = 1.0f;
+    if (radii[i] > 0)
+    {
+        const float ratio = lLength / radii[i];
+        if (ratio >= 1.0f)
+            return;
+        falloff = (1.0f - ratio * ratio) * (1.0f - ratio * ratio);
+    }
+
+    const float visibility = shadowMaps.isEmpty() ? 1.0f : shadowMaps[i]->visibility(position);
+    if (visibility <= 0.0f)
+        return;
+
+    if (lLength > 0)
+    {
+        lx /= lLength;
+        ly /= lLength;
+        lz /= lLength;
+    }
+
+    const float nx    = normal.x();
+    const float ny    = normal.y();
+    const float nz    = normal.z();
+    const float dotNL = nx * lx + ny * ly + nz * lz;
+    const float cosNL = std::max(0.0f, dotNL);
+
+    // R = 2 (N.L) N - L, only its z is needed because V = (0, 0, -1)
+    const float rx      = 2.0f * dotNL * nx - lx;
+    const float ry      = 2.0f * dotNL * ny - ly;
+    const float rz      = 2.0f * dotNL * nz - lz;
+    const float rLength = std::sqrt(rx * rx + ry * ry + rz * rz);
+    const float cosVR   = rLength > 0 ? std::max(0.0f, -rz / rLength) : 0.0f;
+
+    float lightPower = visibility * falloff;
+    if (reflectorEnabled)
+    {
+        const float cosLD = lx * directionsX[i] + ly * directionsY[i] + lz * directionsZ[i];
+        lightPower *= reflector(std::max(0.0f, cosLD));
+    }
+
+    // Shared by the three channels
+    const float intensity = lightPower * (kd * cosNL + ks * specular(cosVR));
+
+    r += colorsR[i] * intensity;
+    g += colorsG[i] * intensity;
+    b += colorsB[i] * intensity;
+}
+
+QRect ShadingContext::lightBounds(int i, int width, int height) const
+{
+    if (radii[i] <= 0)
+        return {0, 0, width, height};
+
+    QVector3D center(positionsX[i], positionsY[i], positionsZ[i]);
+    float radius = radii[i];
+
+    // A reflector is dark outside the cone where its falloff drops under half a color step,
+    // the cone capped by the radius has a tighter bounding sphere than the radius alone
+    const QVector3D direction(directionsX[i], directionsY[i], directionsZ[i]);
+    if (reflectorEnabled && mCoeffReflector > 0 && !direction.isNull())
+    {
+        const float cosCone  = std::pow(0.5f / 255.0f, 1.0f / static_cast<float>(mCoeffReflector));
+        const float sinCone  = std::sqrt(std::max(0.0f, 1.0f - cosCone * cosCone));
+        const QVector3D axis = direction.normalized();
+        // Wide cones are bounded by the sphere through the rim of the cap, narrow ones by the one through the apex
+        if (cosCone < 0.70710678f)
+        {
+            center += axis * (radii[i] * cosCone);
+            radius = radii[i] * sinCone;
+        }
+        else
+        {
+            center += axis * (radii[i] / (2.0f * cosCone));
+            radius = radii[i] / (2.0f * cosCone);
+        }
+    }
+
+    // Orthographic projection, a world-space sphere covers an axis-aligned ellipse on screen
+    const int left   = static_cast<int>(std::floor((center.x() - radius) * width));
+    const int right  = static_cast<int>(std::ceil((center.x() + radius) * width));
+    const int top    = static_cast<int>(std::floor((center.y() - radius) * height));
+    const int bottom = static_cast<int>(std::ceil((center.y() + radius) * height));
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+bool ShadingContext::useTable(const ShadingSettings &settings, int exponent)
+{
+    static constexpr float halfColorStep = 0.5f / 255.0f;
+
+    return settings.exponentLookupTable && exponent >= settings.exponentTableThreshold &&
+           PowerTable::maxError(exponent, settings.exponentTableSize) < halfColorStep;
+}
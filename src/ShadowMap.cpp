@@ -0,0 +1,263 @@
+//
+// Created by wookie on 11/26/24.
+//
+
+#include "models/ShadowMap.h"
+#include "graphics/QGraphicsEngineDrawable.h"
+#include <QMatrix4x4>
+#include <QtConcurrent>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+// Rows rasterized by one worker, every band walks all casters and keeps only what overlaps it
+constexpr int BandHeight = 32;
+// Widest half-angle of the frustum, wider perspectives waste most texels on the borders
+constexpr float MaxHalfAngle = 1.3962634f; // 80 degrees
+} // namespace
+
+bool ShadowMap::update(
+    const QVector3D &lightPosition, const QVector3D &lightDirection,
+    const QVector<QSharedPointer<QGraphicsEngineDrawable>> &casters, const ShadingSettings &settings
+)
+{
+    QVector<CasterVersion> versions;
+    versions.reserve(casters.size());
+    for (const auto &caster : casters)
+    {
+        versions.append({caster.data(), caster->getShadowVersion()});
+    }
+
+    // Lookup parameters do not affect the rendered depth
+    _pcfRadius = settings.shadowPcfRadius;
+    _bias      = settings.shadowBias;
+
+    if (!_depth.isEmpty() && _size == settings.shadowMapSize && _lightPosition == lightPosition &&
+        _lightDirection == lightDirection && _versions == versions)
+        return false;
+
+    _size           = settings.shadowMapSize;
+    _lightPosition  = lightPosition;
+    _lightDirection = lightDirection;
+    _versions       = versions;
+
+    for (const auto &caster : casters)
+    {
+        caster->castShadow(*this);
+    }
+    render();
+    _casters.clear();
+
+    return true;
+}
+
+void ShadowMap::addCaster(const QVector<QVector3D> &positions, const QVector<quint32> &indices)
+{
+    if (!positions.isEmpty() && indices.size() >= 3)
+        _casters.append({positions, indices, {}});
+}
+
+void ShadowMap::render()
+{
+    _depth.fill(0.0f, _size * _size);
+    if (_casters.isEmpty())
+        return;
+
+    fitFrustum();
+
+    const float *m   = _lightMatrix.data();
+    const float size = static_cast<float>(_size);
+    for (Caster &caster : _casters)
+    {
+        caster.projected.resize(caster.positions.size());
+        const QVector3D *positions = caster.positions.constData();
+        QVector3D *projected       = caster.projected.data();
+
+        QtConcurrent::blockingMap(
+            caster.projected,
+            [m, size, positions, projected](QVector3D &vertex)
+            {
+                const QVector3D &p = positions[&vertex - projected];
+                const float w      = m[8] * p.x() + m[9] * p.y() + m[10] * p.z() + m[11];
+                if (w <= 0.0f)
+                {
+                    // Behind the light, triangles using it are skipped
+                    vertex = QVector3D(0, 0, -1);
+                    return;
+                }
+
+                const float invW = 1.0f / w;
+                const float x    = m[0] * p.x() + m[1] * p.y() + m[2] * p.z() + m[3];
+                const float y    = m[4] * p.x() + m[5] * p.y() + m[6] * p.z() + m[7];
+                vertex           = QVector3D((x * invW * 0.5f + 0.5f) * size, (y * invW * 0.5f + 0.5f) * size, invW);
+            }
+        );
+    }
+
+    QVector<int> bandStarts;
+    for (int y = 0; y < _size; y += BandHeight)
+    {
+        bandStarts.append(y);
+    }
+
+    QtConcurrent::blockingMap(
+        bandStarts,
+        [this](const int minY)
+        {
+            const int maxY = std::min(minY + BandHeight, _size) - 1;
+            for (const Caster &caster : _casters)
+            {
+                rasterizeRows(caster, minY, maxY);
+            }
+        }
+    );
+}
+
+void ShadowMap::fitFrustum()
+{
+    QVector3D minCorner(
+        std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()
+    );
+    QVector3D maxCorner = -minCorner;
+    for (const Caster &caster : _casters)
+    {
+        for (const QVector3D &position : caster.positions)
+        {
+            minCorner = QVector3D(
+                std::min(minCorner.x(), position.x()), std::min(minCorner.y(), position.y()),
+                std::min(minCorner.z(), position.z())
+            );
+            maxCorner = QVector3D(
+                std::max(maxCorner.x(), position.x()), std::max(maxCorner.y(), position.y()),
+                std::max(maxCorner.z(), position.z())
+            );
+        }
+    }
+
+    const QVector3D center   = (minCorner + maxCorner) * 0.5f;
+    const float radius       = std::max((maxCorner - minCorner).length() * 0.5f, 1e-4f);
+    const QVector3D toCenter = center - _lightPosition;
+    const float distance     = toCenter.length();
+
+    QVector3D direction = _lightDirection.isNull() ? toCenter : _lightDirection;
+    if (direction.isNull())
+        direction = QVector3D(0, 0, 1);
+    direction.normalize();
+
+    // Wide enough for the bounding sphere of the casters, as seen off the light axis
+    float halfAngle = MaxHalfAngle;
+    if (distance > radius)
+    {
+        const float cosAxis   = std::clamp(QVector3D::dotProduct(direction, toCenter / distance), -1.0f, 1.0f);
+        const float axisAngle = std::acos(cosAxis);
+        halfAngle             = std::min(axisAngle + std::asin(radius / distance), MaxHalfAngle);
+    }
+
+    const float nearPlane = std::max(distance - radius, 0.01f * radius);
+    const float farPlane  = distance + radius;
+    const QVector3D up    = std::abs(direction.y()) < 0.99f ? QVector3D(0, 1, 0) : QVector3D(1, 0, 0);
+
+    QMatrix4x4 view;
+    view.lookAt(_lightPosition, _lightPosition + direction, up);
+    QMatrix4x4 projection;
+    projection.perspective(2.0f * qRadiansToDegrees(halfAngle), 1.0f, nearPlane, farPlane);
+    const QMatrix4x4 lightMatrix = projection * view;
+
+    // The z row is not needed, depth is the inverse of w
+    for (int column = 0; column < 4; column++)
+    {
+        _lightMatrix[column]     = lightMatrix(0, column);
+        _lightMatrix[4 + column] = lightMatrix(1, column);
+        _lightMatrix[8 + column] = lightMatrix(3, column);
+    }
+}
+
+void ShadowMap::rasterizeRows(const Caster &caster, int minY, int maxY)
+{
+    const QVector3D *projected = caster.projected.constData();
+    const quint32 *indices     = caster.indices.constData();
+    const int indexCount       = caster.indices.size();
+
+    for (int i = 0; i + 2 < indexCount; i += 3)
+    {
+        const QVector3D &v0 = projected[indices[i]];
+        const QVector3D &v1 = projected[indices[i + 1]];
+        const QVector3D &v2 = projected[indices[i + 2]];
+        if (v0.z() <= 0 || v1.z() <= 0 || v2.z() <= 0)
+            continue;
+
+        // Same edge functions as the screen rasterizer, both windings cast shadows
+        const float denom = (v1.x() - v0.x()) * (v2.y() - v0.y()) - (v2.x() - v0.x()) * (v1.y() - v0.y());
+        if (denom == 0)
+            continue;
+        const float invDenom = 1.0f / denom;
+
+        const int triangleMinY = std::max(static_cast<int>(std::ceil(std::min({v0.y(), v1.y(), v2.y()}))), minY);
+        const int triangleMaxY = std::min(static_cast<int>(std::floor(std::max({v0.y(), v1.y(), v2.y()}))), maxY);
+        const int minX         = std::max(static_cast<int>(std::floor(std::min({v0.x(), v1.x(), v2.x()}))), 0);
+        const int maxX = std::min(static_cast<int>(std::ceil(std::max({v0.x(), v1.x(), v2.x()}))), _size - 1);
+        if (triangleMinY > triangleMaxY || minX > maxX)
+            continue;
+
+        const float w1StepX = (v2.y() - v0.y()) * invDenom;
+        const float w2StepX = -(v1.y() - v0.y()) * invDenom;
+
+        for (int y = triangleMinY; y <= triangleMaxY; ++y)
+        {
+            const float dx = static_cast<float>(minX) - v0.x();
+            const float dy = static_cast<float>(y) - v0.y();
+            float w1       = (dx * (v2.y() - v0.y()) - (v2.x() - v0.x()) * dy) * invDenom;
+            float w2       = ((v1.x() - v0.x()) * dy - dx * (v1.y() - v0.y())) * invDenom;
+
+            float *depthRow = _depth.data() + y * _size;
+            for (int x = minX; x <= maxX; ++x, w1 += w1StepX, w2 += w2StepX)
+            {
+                const float w0 = 1.0f - w1 - w2;
+                if (w0 < 0 || w1 < 0 || w2 < 0)
+                    continue;
+
+                const float depth = w0 * v0.z() + w1 * v1.z() + w2 * v2.z();
+                depthRow[x]       = std::max(depthRow[x], depth);
+            }
+        }
+    }
+}
+
+float ShadowMap::visibility(const QVector3D &position) const
+{
+    if (_depth.isEmpty())
+        return 1.0f;
+
+    const float *m = _lightMatrix.data();
+    const float w  = m[8] * position.x() + m[9] * position.y() + m[10] * position.z() + m[11];
+    if (w <= 0.0f)
+        return 1.0f;
+
+    const float invW = 1.0f / w;
+    const float x    = m[0] * position.x() + m[1] * position.y() + m[2] * position.z() + m[3];
+    const float y    = m[4] * position.x() + m[5] * position.y() + m[6] * position.z() + m[7];
+    const int texelX = static_cast<int>(std::floor((x * invW * 0.5f + 0.5f) * _size + 0.5f));
+    const int texelY = static_cast<int>(std::floor((y * invW * 0.5f + 0.5f) * _size + 0.5f));
+    if (texelX < 0 || texelY < 0 || texelX >= _size || texelY >= _size)
+        return 1.0f;
+
+    const float *depth = _depth.constData();
+    int litTaps        = 0;
+    int taps           = 0;
+    for (int dy = -_pcfRadius; dy <= _pcfRadius; ++dy)
+    {
+        const float *row = depth + qBound(0, texelY + dy, _size - 1) * _size;
+        for (int dx = -_pcfRadius; dx <= _pcfRadius; ++dx)
+        {
+            // Lit when the nearest caster is not closer than the position minus the bias, 1 / stored >= w - bias
+            const float stored = row[qBound(0, texelX + dx, _size - 1)];
+            litTaps += w * stored <= 1.0f + _bias * stored ? 1 : 0;
+            taps++;
+        }
+    }
+
+    return static_cast<float>(litTaps) / static_cast<float>(taps);
+}
@@ -0,0 +1,64 @@
+//
+// Created by wookie on 11/25/24.
+//
+
+#include "graphics/TexelGrid.h"
+#include <algorithm>
+#include <cmath>
+
+TexelGrid TexelGrid::create(TextureLayout layout, int width, int height)
+{
+    TexelGrid grid;
+    grid.width   = width;
+    grid.height  = height;
+    grid.blocksX = (width + 3) / 4;
+
+    switch (layout)
+    {
+    case TextureLayout::RowMajor:
+        grid.storageSize = width * height;
+        break;
+    case TextureLayout::Tiled:
+        grid.storageSize = grid.blocksX * ((height + 3) / 4) * 16;
+        break;
+    case TextureLayout::Morton:
+    {
+        int log2Width  = 0;
+        int log2Height = 0;
+        while ((1 << log2Width) < width)
+            ++log2Width;
+        while ((1 << log2Height) < height)
+            ++log2Height;
+        grid.mortonBits  = std::min(log2Width, log2Height);
+        grid.storageSize = (1 << log2Width) * (1 << log2Height);
+        break;
+    }
+    }
+
+    return grid;
+}
+
+float TexelGrid::computeLod(const UvGradient &gradient, float maxLod) const
+{
+    const float footprintX = std::hypot(gradient.dudx * width, gradient.dvdx * height);
+    const float footprintY = std::hypot(gradient.dudy * width, gradient.dvdy * height);
+    const float footprint  = std::max(footprintX, footprintY);
+    if (footprint <= 1.0f)
+        return 0.0f;
+
+    return std::min(std::log2(footprint), maxLod);
+}
+
+int TexelGrid::index(TextureLayout layout, int x, int y) const
+{
+    switch (layout)
+    {
+    case TextureLayout::Tiled:
+        return index<TextureLayout::Tiled>(x, y);
+    case TextureLayout::Morton:
+        return index<TextureLayout::Morton>(x, y);
+    case TextureLayout::RowMajor:
+        break;
+    }
+    return index<TextureLayout::RowMajor>(x, y);
+}
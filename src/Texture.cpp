@@ -0,0 +1,158 @@
+//
+// Created by wookie on 11/24/24.
+//
+
+#include "graphics/Texture.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+Texture::Texture(const QImage &image, TextureLayout layout) : _layout(layout)
+{
+    const QImage converted = image.convertToFormat(QImage::Format_ARGB32);
+
+    MipLevel base{TexelGrid::create(layout, converted.width(), converted.height()), {}};
+    base.texels.resize(base.grid.storageSize);
+    for (int y = 0; y < base.grid.height; ++y)
+    {
+        const QRgb *source = reinterpret_cast<const QRgb *>(converted.constScanLine(y));
+        for (int x = 0; x < base.grid.width; ++x)
+            base.texels[base.grid.index(layout, x, y)] = source[x];
+    }
+    _levels.append(std::move(base));
+
+    buildMipChain();
+}
+
+void Texture::buildMipChain()
+{
+    while (_levels.last().grid.width > 1 || _levels.last().grid.height > 1)
+    {
+        const MipLevel &parent     = _levels.last();
+        const TexelGrid &source    = parent.grid;
+        const TextureLayout layout = _layout;
+        MipLevel level{TexelGrid::create(layout, std::max(1, source.width / 2), std::max(1, source.height / 2)), {}};
+        level.texels.resize(level.grid.storageSize);
+
+        QVector<int> rows(level.grid.height);
+        std::iota(rows.begin(), rows.end(), 0);
+
+        // Box filter over the 2x2 parent texels, odd edges reuse the last row or column.
+        // Rows of a level never share a storage slot in any layout, so they can be written concurrently.
+        QRgb *texels = level.texels.data();
+        QtConcurrent::blockingMap(
+            rows,
+            [layout, &parent, &source, &level, texels](const int y)
+            {
+                const int y0 = std::min(2 * y, source.height - 1);
+                const int y1 = std::min(2 * y + 1, source.height - 1);
+                for (int x = 0; x < level.grid.width; ++x)
+                {
+                    const int x0 = std::min(2 * x, source.width - 1);
+                    const int x1 = std::min(2 * x + 1, source.width - 1);
+
+                    const QRgb c00 = parent.texels[source.index(layout, x0, y0)];
+                    const QRgb c01 = parent.texels[source.index(layout, x1, y0)];
+                    const QRgb c10 = parent.texels[source.index(layout, x0, y1)];
+                    const QRgb c11 = parent.texels[source.index(layout, x1, y1)];
+
+                    texels[level.grid.index(layout, x, y)] = qRgba(
+                        (qRed(c00) + qRed(c01) + qRed(c10) + qRed(c11) + 2) / 4,
+                        (qGreen(c00) + qGreen(c01) + qGreen(c10) + qGreen(c11) + 2) / 4,
+                        (qBlue(c00) + qBlue(c01) + qBlue(c10) + qBlue(c11) + 2) / 4,
+                        (qAlpha(c00) + qAlpha(c01) + qAlpha(c10) + qAlpha(c11) + 2) / 4
+                    );
+                }
+            }
+        );
+
+        _levels.append(std::move(level));
+    }
+}
+
+QRgb Texture::sample(float u, float v, float lod, TextureFilter filter) const
+{
+    // Dispatched once per sample, so the texel addressing inside the filters is branch-free
+    switch (_layout)
+    {
+    case TextureLayout::Tiled:
+        return sampleLayout<TextureLayout::Tiled>(u, v, lod, filter);
+    case TextureLayout::Morton:
+        return sampleLayout<TextureLayout::Morton>(u, v, lod, filter);
+    case TextureLayout::RowMajor:
+        break;
+    }
+    return sampleLayout<TextureLayout::RowMajor>(u, v, lod, filter);
+}
+
+template <TextureLayout Layout>
+QRgb Texture::sampleLayout(float u, float v, float lod, TextureFilter filter) const
+{
+    switch (filter)
+    {
+    case TextureFilter::Nearest:
+    {
+        const MipLevel &level = _levels[nearestLevel(lod)];
+        return level.texels[level.grid.nearest<Layout>(u, v)];
+    }
+    case TextureFilter::Bilinear:
+    {
+        float argb[4];
+        sampleBilinear<Layout>(_levels[nearestLevel(lod)], u, v, argb);
+        return packTexel(argb);
+    }
+    case TextureFilter::Trilinear:
+        break;
+    }
+
+    const int lower = std::clamp(static_cast<int>(lod), 0, static_cast<int>(_levels.size()) - 1);
+    const float t   = lod - static_cast<float>(lower);
+
+    float argb[4];
+    sampleBilinear<Layout>(_levels[lower], u, v, argb);
+    if (t <= 0.0f || lower + 1 >= _levels.size())
+        return packTexel(argb);
+
+    float upper[4];
+    sampleBilinear<Layout>(_levels[lower + 1], u, v, upper);
+    for (int channel = 0; channel < 4; ++channel)
+        argb[channel] += (upper[channel] - argb[channel]) * t;
+    return packTexel(argb);
+}
+
+int Texture::nearestLevel(float lod) const
+{
+    return std::clamp(static_cast<int>(lod + 0.5f), 0, static_cast<int>(_levels.size()) - 1);
+}
+
+template <TextureLayout Layout>
+void Texture::sampleBilinear(const MipLevel &level, float u, float v, float *argb)
+{
+    const BilinearFootprint footprint = level.grid.bilinear<Layout>(u, v);
+
+    const QRgb *texels = level.texels.constData();
+    const QRgb c00     = texels[footprint.i00];
+    const QRgb c01     = texels[footprint.i01];
+    const QRgb c10     = texels[footprint.i10];
+    const QRgb c11     = texels[footprint.i11];
+
+    const float w00 = footprint.w00;
+    const float w01 = footprint.w01;
+    const float w10 = footprint.w10;
+    const float w11 = footprint.w11;
+
+    argb[0] = w00 * qAlpha(c00) + w01 * qAlpha(c01) + w10 * qAlpha(c10) + w11 * qAlpha(c11);
+    argb[1] = w00 * qRed(c00) + w01 * qRed(c01) + w10 * qRed(c10) + w11 * qRed(c11);
+    argb[2] = w00 * qGreen(c00) + w01 * qGreen(c01) + w10 * qGreen(c10) + w11 * qGreen(c11);
+    argb[3] = w00 * qBlue(c00) + w01 * qBlue(c01) + w10 * qBlue(c10) + w11 * qBlue(c11);
+}
+
+QRgb Texture::packTexel(const float *argb)
+{
+    auto toByte = [](float channel)
+    {
+        return static_cast<int>(channel + 0.5f);
+    };
+    return qRgba(toByte(argb[1]), toByte(argb[2]), toByte(argb[3]), toByte(argb[0]));
+}
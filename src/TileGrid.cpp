@@ -0,0 +1,61 @@
+//
+// Created by wookie on 11/16/24.
+//
+
+#include "models/TileGrid.h"
+#include <algorithm>
+
+TileGrid::TileGrid(int width, int height, int tileSize) { resize(width, height, tileSize); }
+
+void TileGrid::resize(int width, int height, int tileSize)
+{
+    Q_ASSERT(tileSize > 0);
+    _width    = width;
+    _height   = height;
+    _tileSize = tileSize;
+    _tilesX   = (width + tileSize - 1) / tileSize;
+    _tilesY   = (height + tileSize - 1) / tileSize;
+
+    _tiles.resize(_tilesX * _tilesY);
+    for (int ty = 0; ty < _tilesY; ty++)
+    {
+        for (int tx = 0; tx < _tilesX; tx++)
+        {
+            const int x = tx * tileSize;
+            const int y = ty * tileSize;
+
+            Tile &tile = _tiles[ty * _tilesX + tx];
+            tile.rect  = QRect(x, y, std::min(tileSize, width - x), std::min(tileSize, height - y));
+            tile.triangleIndices.resize(0);
+        }
+    }
+}
+
+void TileGrid::clearBins()
+{
+    // resize(0) keeps the capacity, so steady-state binning does not allocate
+    for (Tile &tile : _tiles)
+    {
+        tile.triangleIndices.resize(0);
+    }
+}
+
+void TileGrid::binTriangle(int triangleIndex, const QRect &bounds)
+{
+    const QRect clipped = bounds.intersected(QRect(0, 0, _width, _height));
+    if (clipped.isEmpty())
+        return;
+
+    const int tileMinX = clipped.left() / _tileSize;
+    const int tileMaxX = clipped.right() / _tileSize;
+    const int tileMinY = clipped.top() / _tileSize;
+    const int tileMaxY = clipped.bottom() / _tileSize;
+
+    for (int ty = tileMinY; ty <= tileMaxY; ty++)
+    {
+        for (int tx = tileMinX; tx <= tileMaxX; tx++)
+        {
+            _tiles[ty * _tilesX + tx].triangleIndices.append(triangleIndex);
+        }
+    }
+}
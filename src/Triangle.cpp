@@ -3,7 +3,7 @@
 //
 
 #include "geometry/Triangle.h"
-#include "geometry/Vertex.h"
+#include "graphics/PixelQuadKernel.h"
 #include "models/DrawData.h"
 #include "settings/Settings.h"
 #include "utils/DrawUtils.h"
@@ -12,66 +12,335 @@
 #include <QMatrix4x4>
 #include <QVector2D>
 #include <cmath>
+#include <limits>
 
-[[maybe_unused]] Triangle::Triangle(Vertex a, Vertex b, Vertex c) : _a(a), _b(b), _c(c) {}
+Triangle::Triangle(const VertexBuffer &vertices, quint32 a, quint32 b, quint32 c)
+    : _vertices(&vertices), _indices{a, b, c}
+{
+}
 
-Vertex &Triangle::operator[](int i)
+void Triangle::drawVertices(DrawData &drawData) const
 {
-    switch (i)
+    for (const quint32 index : _indices)
     {
-    case 0:
-        return _a;
-    case 1:
-        return _b;
-    case 2:
-        return _c;
-    default:
+        _vertices->getVertex(index).draw(drawData);
+    }
+}
+
+QRect Triangle::getScreenBounds() const
+{
+    const VertexStruct *screenVertices = _vertices->getScreenVertices().constData();
+    const VertexStruct &a              = screenVertices[_indices[0]];
+    const VertexStruct &b              = screenVertices[_indices[1]];
+    const VertexStruct &c              = screenVertices[_indices[2]];
+
+    const float minX = std::min({a.x, b.x, c.x});
+    const float maxX = std::max({a.x, b.x, c.x});
+    const float minY = std::min({a.y, b.y, c.y});
+    const float maxY = std::max({a.y, b.y, c.y});
+
+    // The scanline fill reaches one pixel left of the edge, so the bounds are widened to match
+    return QRect(
+        QPoint(static_cast<int>(std::floor(minX)) - 1, static_cast<int>(std::floor(minY))),
+        QPoint(static_cast<int>(std::ceil(maxX)), static_cast<int>(std::ceil(maxY)))
+    );
+}
+
+float Triangle::getNearestDepth() const
+{
+    // Called right after a transform, before the screen vertices of the frame exist
+    const QVector3D *positions = _vertices->getPositionsTransformed().constData();
+    return std::max({positions[_indices[0]].z(), positions[_indices[1]].z(), positions[_indices[2]].z()});
+}
+
+PrimitiveVisibility
+Triangle::classify(int width, int height, const QRect &screenBounds, bool cullBackFaces, int guardBand) const
+{
+    if (!screenBounds.intersects(QRect(0, 0, width, height)))
+        return PrimitiveVisibility::OutsideViewport;
+
+    const VertexStruct *screenVertices = _vertices->getScreenVertices().constData();
+    const VertexStruct &a              = screenVertices[_indices[0]];
+    const VertexStruct &b              = screenVertices[_indices[1]];
+    const VertexStruct &c              = screenVertices[_indices[2]];
+    const float area                   = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+    if (area == 0 || (cullBackFaces && area < 0))
+        return PrimitiveVisibility::BackFacing;
+
+    const QRect guardBandRect(-guardBand, -guardBand, width + 2 * guardBand, height + 2 * guardBand);
+    if (!guardBandRect.contains(screenBounds))
+        return PrimitiveVisibility::NeedsClipping;
+
+    return PrimitiveVisibility::Visible;
+}
+
+template <typename Function>
+void Triangle::forEachClippedTriangle(
+    const std::array<VertexStruct, 3> &vertices, int width, int height, int guardBand, Function function
+)
+{
+    const float band = static_cast<float>(guardBand);
+    const QRectF guardBandRect(-band, -band, width + 2 * band, height + 2 * band);
+
+    std::array<VertexStruct, 9> polygon;
+    const int vertexCount = clipToRect(vertices, guardBandRect, polygon);
+
+    // Clipping keeps the polygon convex and the winding unchanged, so a fan from the first vertex covers it
+    for (int i = 1; i + 1 < vertexCount; i++)
     {
-        qDebug() << "Triangle::operator[]: index out of bounds";
-        return _a;
+        function({polygon[0], polygon[i], polygon[i + 1]});
     }
+}
+
+void Triangle::rasterize(DrawData &drawData, const QRect &clipRect, bool clipToGuardBand)
+{
+    Settings &settings = Settings::getInstance();
+
+    const std::array<VertexStruct, 3> vertices = getScreenVertices();
+    if (!clipToGuardBand)
+    {
+        rasterizeVertices(drawData, settings, vertices, clipRect);
+        return;
     }
+
+    forEachClippedTriangle(
+        vertices, drawData.canvas.width(), drawData.canvas.height(), settings.rasterizerSettings.guardBand,
+        [&drawData, &settings, &clipRect](const std::array<VertexStruct, 3> &clipped)
+        {
+            rasterizeVertices(drawData, settings, clipped, clipRect);
+        }
+    );
 }
 
-void Triangle::draw(DrawData &drawData)
+void Triangle::rasterizeVisibility(DrawData &drawData, quint32 primitiveId, bool clipToGuardBand) const
 {
+    const std::array<VertexStruct, 3> vertices = getScreenVertices();
+    if (!clipToGuardBand)
+    {
+        rasterizeVisibilityVertices(drawData, vertices, primitiveId);
+        return;
+    }
 
-    Settings &settings = Settings::getInstance();
+    forEachClippedTriangle(
+        vertices, drawData.canvas.width(), drawData.canvas.height(),
+        Settings::getInstance().rasterizerSettings.guardBand,
+        [&drawData, primitiveId](const std::array<VertexStruct, 3> &clipped)
+        {
+            rasterizeVisibilityVertices(drawData, clipped, primitiveId);
+        }
+    );
+}
+
+void Triangle::rasterizeVisibilityVertices(
+    DrawData &drawData, const std::array<VertexStruct, 3> &vertices, quint32 primitiveId
+)
+{
+    const VertexStruct &v0 = vertices[0];
+    const VertexStruct &v1 = vertices[1];
+    const VertexStruct &v2 = vertices[2];
 
-    const QVector3D posA = _a.getPositionTransformed();
-    const QVector3D posB = _b.getPositionTransformed();
-    const QVector3D posC = _c.getPositionTransformed();
+    const float denom = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (denom == 0)
+        return;
+    const float invDenom = 1.0f / denom;
 
-    const QVector3D normalA = _a.getNormalTransformed().normalized();
-    const QVector3D normalB = _b.getNormalTransformed().normalized();
-    const QVector3D normalC = _c.getNormalTransformed().normalized();
+    const int minX = std::max(static_cast<int>(std::floor(std::min({v0.x, v1.x, v2.x}))), 0);
+    const int maxX = std::min(static_cast<int>(std::ceil(std::max({v0.x, v1.x, v2.x}))), drawData.canvas.width() - 1);
+    const int minY = std::max(static_cast<int>(std::ceil(std::min({v0.y, v1.y, v2.y}))), 0);
+    const int maxY =
+        std::min(static_cast<int>(std::floor(std::max({v0.y, v1.y, v2.y}))), drawData.canvas.height() - 1);
 
-    const int width  = drawData.canvas.width();
-    const int height = drawData.canvas.height();
+    const float w1StepX = (v2.y - v0.y) * invDenom;
+    const float w2StepX = -(v1.y - v0.y) * invDenom;
 
-    float x0 = posA.x() * width;
-    float y0 = posA.y() * height;
-    float z0 = posA.z();
+    VisibilityBuffer &visibilityBuffer = *drawData.visibilityBuffer;
+    for (int y = minY; y <= maxY; ++y)
+    {
+        const float dx = static_cast<float>(minX) - v0.x;
+        const float dy = static_cast<float>(y) - v0.y;
+        float w1       = (dx * (v2.y - v0.y) - (v2.x - v0.x) * dy) * invDenom;
+        float w2       = ((v1.x - v0.x) * dy - dx * (v1.y - v0.y)) * invDenom;
+
+        // The z-buffer only holds earlier meshes and overlays here, nothing writes it during this pass
+        const float *depthRow = drawData.depthRow(y);
+        for (int x = minX; x <= maxX; ++x, w1 += w1StepX, w2 += w2StepX)
+        {
+            const float w0 = 1.0f - w1 - w2;
+            if (w0 < 0 || w1 < 0 || w2 < 0)
+                continue;
 
-    float x1 = posB.x() * width;
-    float y1 = posB.y() * height;
-    float z1 = posB.z();
+            const float z = w0 * v0.z + w1 * v1.z + w2 * v2.z;
+            if (z < depthRow[x])
+                continue;
 
-    float x2 = posC.x() * width;
-    float y2 = posC.y() * height;
-    float z2 = posC.z();
+            visibilityBuffer.testAndSet(x, y, VisibilityBuffer::pack(z, primitiveId));
+        }
+    }
+}
 
-    const VertexStruct v0 = {
-        x0, y0, z0, posA, normalA, _a.getU(), _a.getV(), _a.getUTangentTransformed(), _a.getVTangentTransformed()
-    };
-    const VertexStruct v1 = {
-        x1, y1, z1, posB, normalB, _b.getU(), _b.getV(), _b.getUTangentTransformed(), _b.getVTangentTransformed()
+ResolveSetup Triangle::prepareResolve(const DrawData &drawData) const
+{
+    const std::array<VertexStruct, 3> vertices = getScreenVertices();
+    const VertexStruct &v0                     = vertices[0];
+    const VertexStruct &v1                     = vertices[1];
+    const VertexStruct &v2                     = vertices[2];
+
+    ResolveSetup setup;
+    setup.originX = v0.x;
+    setup.originY = v0.y;
+    setup.lod     = drawData.computeSurfaceLod(computeUvGradient(vertices));
+
+    // A degenerate triangle covers no pixel, so it never reaches the resolve
+    const float denom = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (denom == 0)
+        return setup;
+    const float invDenom = 1.0f / denom;
+
+    setup.w1dx = (v2.y - v0.y) * invDenom;
+    setup.w1dy = -(v2.x - v0.x) * invDenom;
+    setup.w2dx = -(v1.y - v0.y) * invDenom;
+    setup.w2dy = (v1.x - v0.x) * invDenom;
+    return setup;
+}
+
+void Triangle::resolveFragment(DrawData &drawData, Settings &settings, const ResolveSetup &setup, int x, int y) const
+{
+    const float dx = static_cast<float>(x) - setup.originX;
+    const float dy = static_cast<float>(y) - setup.originY;
+    const float w1 = setup.w1dx * dx + setup.w1dy * dy;
+    const float w2 = setup.w2dx * dx + setup.w2dy * dy;
+
+    drawFragment(drawData, settings, getScreenVertices(), QVector3D(1.0f - w1 - w2, w1, w2), setup.lod, x, y);
+}
+
+void Triangle::rasterizeVertices(
+    DrawData &drawData, Settings &settings, const std::array<VertexStruct, 3> &vertices, const QRect &clipRect
+)
+{
+    // Mip levels are chosen once per triangle, every pixel quad of it would measure the same UV derivatives
+    const SurfaceLod lod = drawData.computeSurfaceLod(computeUvGradient(vertices));
+
+    // Coverage is tested per sample, which only the half-space traversal can do
+    if (drawData.canvas.getSampleCount() > 1)
+    {
+        rasterizeMultisampled(drawData, settings, vertices, clipRect, lod);
+        return;
+    }
+
+    switch (settings.rasterizerSettings.rasterizationMode)
+    {
+    case RasterizationMode::Scanline:
+        rasterizeScanline(drawData, settings, vertices, clipRect, lod);
+        break;
+    case RasterizationMode::HalfSpace:
+        rasterizeHalfSpace(drawData, settings, vertices, clipRect, lod, false);
+        break;
+    case RasterizationMode::HalfSpaceSimd:
+        rasterizeHalfSpace(drawData, settings, vertices, clipRect, lod, true);
+        break;
+    }
+}
+
+UvGradient Triangle::computeUvGradient(const std::array<VertexStruct, 3> &vertices)
+{
+    const VertexStruct &v0 = vertices[0];
+    const VertexStruct &v1 = vertices[1];
+    const VertexStruct &v2 = vertices[2];
+
+    const float denom = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (denom == 0)
+        return {};
+    const float invDenom = 1.0f / denom;
+
+    // Derivatives of the barycentric weights w1 and w2
+    const float w1dx = (v2.y - v0.y) * invDenom;
+    const float w1dy = -(v2.x - v0.x) * invDenom;
+    const float w2dx = -(v1.y - v0.y) * invDenom;
+    const float w2dy = (v1.x - v0.x) * invDenom;
+
+    const float du1 = v1.u - v0.u;
+    const float du2 = v2.u - v0.u;
+    const float dv1 = v1.v - v0.v;
+    const float dv2 = v2.v - v0.v;
+
+    return {du1 * w1dx + du2 * w2dx, dv1 * w1dx + dv2 * w2dx, du1 * w1dy + du2 * w2dy, dv1 * w1dy + dv2 * w2dy};
+}
+
+int Triangle::clipToRect(
+    const std::array<VertexStruct, 3> &vertices, const QRectF &rect, std::array<VertexStruct, 9> &polygon
+)
+{
+    // Signed distance to one of the four rectangle edges, positive inside
+    auto distance = [&rect](int edge, const VertexStruct &vertex) -> float
+    {
+        switch (edge)
+        {
+        case 0:
+            return vertex.x - static_cast<float>(rect.left());
+        case 1:
+            return static_cast<float>(rect.right()) - vertex.x;
+        case 2:
+            return vertex.y - static_cast<float>(rect.top());
+        default:
+            return static_cast<float>(rect.bottom()) - vertex.y;
+        }
     };
-    const VertexStruct v2 = {
-        x2, y2, z2, posC, normalC, _c.getU(), _c.getV(), _c.getUTangentTransformed(), _c.getVTangentTransformed()
+
+    std::copy(vertices.begin(), vertices.end(), polygon.begin());
+    int vertexCount = 3;
+
+    // Sutherland-Hodgman, every edge adds at most one vertex
+    std::array<VertexStruct, 9> input;
+    for (int edge = 0; edge < 4 && vertexCount > 0; edge++)
+    {
+        std::copy(polygon.begin(), polygon.begin() + vertexCount, input.begin());
+        const int inputCount = vertexCount;
+        vertexCount          = 0;
+
+        for (int i = 0; i < inputCount; i++)
+        {
+            const VertexStruct &current = input[i];
+            const VertexStruct &next    = input[(i + 1) % inputCount];
+            const float currentDistance = distance(edge, current);
+            const float nextDistance    = distance(edge, next);
+
+            if (currentDistance >= 0)
+                polygon[vertexCount++] = current;
+            if ((currentDistance >= 0) != (nextDistance >= 0))
+                polygon[vertexCount++] = lerpVertex(current, next, currentDistance / (currentDistance - nextDistance));
+        }
+    }
+
+    return vertexCount;
+}
+
+VertexStruct Triangle::lerpVertex(const VertexStruct &a, const VertexStruct &b, float t)
+{
+    return {
+        a.x + (b.x - a.x) * t,
+        a.y + (b.y - a.y) * t,
+        a.z + (b.z - a.z) * t,
+        a.pos + (b.pos - a.pos) * t,
+        a.normal + (b.normal - a.normal) * t,
+        a.u + (b.u - a.u) * t,
+        a.v + (b.v - a.v) * t,
+        a.uTangent + (b.uTangent - a.uTangent) * t,
+        a.vTangent + (b.vTangent - a.vTangent) * t,
+        a.irradiance + (b.irradiance - a.irradiance) * t
     };
+}
+
+std::array<VertexStruct, 3> Triangle::getScreenVertices() const
+{
+    const VertexStruct *screenVertices = _vertices->getScreenVertices().constData();
+    return {screenVertices[_indices[0]], screenVertices[_indices[1]], screenVertices[_indices[2]]};
+}
 
-    std::array<VertexStruct, 3> vertices = {v0, v1, v2};
+void Triangle::rasterizeScanline(
+    DrawData &drawData, Settings &settings, std::array<VertexStruct, 3> vertices, const QRect &clipRect,
+    const SurfaceLod &lod
+)
+{
     std::sort(
         vertices.begin(), vertices.end(),
         [](const VertexStruct &a, const VertexStruct &b)
@@ -80,10 +349,13 @@ void Triangle::draw(DrawData &drawData)
         }
     );
 
-    const int minY = std::max(static_cast<int>(std::ceil(vertices[0].y)), 0);
-    const int maxY = std::min(static_cast<int>(std::floor(vertices[2].y)), height - 1);
+    const int minY = std::max(static_cast<int>(std::ceil(vertices[0].y)), clipRect.top());
+    const int maxY = std::min(static_cast<int>(std::floor(vertices[2].y)), clipRect.bottom());
+    if (minY > maxY)
+        return;
 
-    auto createEdge = [](const VertexStruct &vStart, const VertexStruct &vEnd) -> EdgeStruct
+    // Edges starting above the clip rectangle enter the table at its first row, already stepped to that row
+    auto createEdge = [minY](const VertexStruct &vStart, const VertexStruct &vEnd) -> EdgeStruct
     {
         if (vStart.y == vEnd.y)
             return {0, 0, 0};
@@ -92,7 +364,7 @@ void Triangle::draw(DrawData &drawData)
         const float dx = vEnd.x - vStart.x;
 
         const float xStep = dx / dy;
-        const int yMin    = static_cast<int>(std::ceil(vStart.y));
+        const int yMin    = std::max(static_cast<int>(std::ceil(vStart.y)), minY);
         const int yMax    = static_cast<int>(std::ceil(vEnd.y)) - 1;
 
         const float x = vStart.x + (yMin - vStart.y) * xStep;
@@ -100,7 +372,7 @@ void Triangle::draw(DrawData &drawData)
         return {yMax, x, xStep};
     };
 
-    std::vector<std::vector<EdgeStruct>> edgeTable(height);
+    std::vector<std::vector<EdgeStruct>> edgeTable(maxY - minY + 1);
 
     auto addEdgeToTable = [&](const VertexStruct &vStart, const VertexStruct &vEnd)
     {
@@ -108,9 +380,9 @@ void Triangle::draw(DrawData &drawData)
             return;
 
         const EdgeStruct edge = createEdge(vStart, vEnd);
-        const int yIndex      = static_cast<int>(std::ceil(vStart.y));
-        if (yIndex >= 0 && yIndex < height)
-            edgeTable[yIndex].push_back(edge);
+        const int yIndex      = std::max(static_cast<int>(std::ceil(vStart.y)), minY);
+        if (yIndex <= maxY && edge.yMax >= yIndex)
+            edgeTable[yIndex - minY].push_back(edge);
     };
 
     addEdgeToTable(vertices[0], vertices[1]);
@@ -121,10 +393,7 @@ void Triangle::draw(DrawData &drawData)
 
     for (int y = minY; y <= maxY; ++y)
     {
-        if (y >= 0 && y < height)
-        {
-            activeEdgeTable.insert(activeEdgeTable.end(), edgeTable[y].begin(), edgeTable[y].end());
-        }
+        activeEdgeTable.insert(activeEdgeTable.end(), edgeTable[y - minY].begin(), edgeTable[y - minY].end());
 
         activeEdgeTable.erase(
             std::remove_if(
@@ -153,8 +422,8 @@ void Triangle::draw(DrawData &drawData)
             int xStart = static_cast<int>(std::ceil(activeEdgeTable[i].x));
             int xEnd   = static_cast<int>(std::floor(activeEdgeTable[i + 1].x));
 
-            xStart = std::max(xStart - 1, 0);
-            xEnd   = std::min(xEnd, width - 1);
+            xStart = std::max(xStart - 1, clipRect.left());
+            xEnd   = std::min(xEnd, clipRect.right());
 
             for (int x = xStart; x <= xEnd; ++x)
             {
@@ -166,98 +435,308 @@ void Triangle::draw(DrawData &drawData)
                 if (barycentric.x() < 0 || barycentric.y() < 0 || barycentric.z() < 0)
                     continue;
 
-                float z =
-                    barycentric.x() * vertices[0].z + barycentric.y() * vertices[1].z + barycentric.z() * vertices[2].z;
+                drawFragment(drawData, settings, vertices, barycentric, lod, x, y);
+            }
+        }
 
-                if (z < drawData.zBuffer.data()[x * height + y])
-                    continue;
-                drawData.zBuffer.data()[x * height + y] = z;
-
-                const QVector3D pos = barycentric.x() * vertices[0].pos + barycentric.y() * vertices[1].pos +
-                                      barycentric.z() * vertices[2].pos;
-                QVector3D normal = (barycentric.x() * vertices[0].normal + barycentric.y() * vertices[1].normal +
-                                    barycentric.z() * vertices[2].normal)
-                                       .normalized();
-                const float u =
-                    barycentric.x() * vertices[0].u + barycentric.y() * vertices[1].u + barycentric.z() * vertices[2].u;
-                const float v =
-                    barycentric.x() * vertices[0].v + barycentric.y() * vertices[1].v + barycentric.z() * vertices[2].v;
-
-                if (drawData.normalMap)
-                {
-                    const QVector3D uTangent = barycentric.x() * vertices[0].uTangent +
-                                               barycentric.y() * vertices[1].uTangent +
-                                               barycentric.z() * vertices[2].uTangent;
-                    const QVector3D vTangent = barycentric.x() * vertices[0].vTangent +
-                                               barycentric.y() * vertices[1].vTangent +
-                                               barycentric.z() * vertices[2].vTangent;
-                    getNormalFromMap(drawData, vertices, u, v, normal, uTangent, vTangent);
-                }
+        for (auto &edge : activeEdgeTable)
+        {
+            edge.x += edge.xStep;
+        }
+    }
+}
 
-                QColor color;
-                getColor(drawData, u, v, color);
+void Triangle::rasterizeHalfSpace(
+    DrawData &drawData, Settings &settings, const std::array<VertexStruct, 3> &vertices, const QRect &clipRect,
+    const SurfaceLod &lod, bool useQuadKernel
+)
+{
+    const VertexStruct &v0 = vertices[0];
+    const VertexStruct &v1 = vertices[1];
+    const VertexStruct &v2 = vertices[2];
 
-                if (settings.triangleSettings.debugDraw)
-                {
-                    drawPixelDebug(drawData, settings, y, x, barycentric, pos, normal);
-                }
-                else
+    // Same denominator as computeBarycentricCoordinates, so both paths produce identical weights
+    const float denom = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (denom == 0)
+        return;
+    const float invDenom = 1.0f / denom;
+
+    const int minX = std::max(static_cast<int>(std::floor(std::min({v0.x, v1.x, v2.x}))), clipRect.left());
+    const int maxX = std::min(static_cast<int>(std::ceil(std::max({v0.x, v1.x, v2.x}))), clipRect.right());
+    const int minY = std::max(static_cast<int>(std::ceil(std::min({v0.y, v1.y, v2.y}))), clipRect.top());
+    const int maxY = std::min(static_cast<int>(std::floor(std::max({v0.y, v1.y, v2.y}))), clipRect.bottom());
+    if (minX > maxX || minY > maxY)
+        return;
+
+    // Edge functions pre-scaled by 1 / area, so stepping one pixel right is a single add per weight
+    const float w1StepX = (v2.y - v0.y) * invDenom;
+    const float w2StepX = -(v1.y - v0.y) * invDenom;
+
+    QuadSetup quadSetup;
+    QuadFragments quadFragments;
+    if (useQuadKernel)
+        quadSetup = PixelQuadKernel::createSetup(
+            vertices, drawData.shadingContext.perVertexLighting, drawData.usesNormalMap()
+        );
+
+    for (int y = minY; y <= maxY; ++y)
+    {
+        // Every row restarts from the exact value, keeping the accumulated error bounded by one row
+        const float dx = static_cast<float>(minX) - v0.x;
+        const float dy = static_cast<float>(y) - v0.y;
+        float w1       = (dx * (v2.y - v0.y) - (v2.x - v0.x) * dy) * invDenom;
+        float w2       = ((v1.x - v0.x) * dy - dx * (v1.y - v0.y)) * invDenom;
+
+        if (useQuadKernel)
+        {
+            float *depthRow = drawData.depthRow(y);
+            for (int x = minX; x <= maxX; x += PixelQuadKernel::QuadWidth)
+            {
+                const float offset    = static_cast<float>(x - minX);
+                const int laneCount   = std::min(PixelQuadKernel::QuadWidth, maxX - x + 1);
+                const int passedLanes = PixelQuadKernel::processQuad(
+                    quadSetup, w1 + offset * w1StepX, w2 + offset * w2StepX, w1StepX, w2StepX, depthRow + x,
+                    laneCount, quadFragments
+                );
+
+                for (int lane = 0; passedLanes != 0 && lane < laneCount; ++lane)
                 {
-                    DrawUtils::drawPixel(drawData, pos, normal, color, x, y);
+                    if (passedLanes & (1 << lane))
+                        shadeQuadLane(drawData, settings, quadFragments, lane, lod, x + lane, y);
                 }
             }
+            continue;
         }
 
-        for (auto &edge : activeEdgeTable)
+        for (int x = minX; x <= maxX; ++x, w1 += w1StepX, w2 += w2StepX)
         {
-            edge.x += edge.xStep;
+            const float w0 = 1.0f - w1 - w2;
+            if (w0 < 0 || w1 < 0 || w2 < 0)
+                continue;
+
+            drawFragment(drawData, settings, vertices, QVector3D(w0, w1, w2), lod, x, y);
         }
     }
+}
 
-    if (settings.triangleSettings.debugDraw)
+void Triangle::rasterizeMultisampled(
+    DrawData &drawData, Settings &settings, const std::array<VertexStruct, 3> &vertices, const QRect &clipRect,
+    const SurfaceLod &lod
+)
+{
+    const VertexStruct &v0 = vertices[0];
+    const VertexStruct &v1 = vertices[1];
+    const VertexStruct &v2 = vertices[2];
+
+    const float denom = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (denom == 0)
+        return;
+    const float invDenom = 1.0f / denom;
+
+    // Samples lie less than half a pixel from the center, so pixels with centers just outside may still be covered
+    const int minX = std::max(static_cast<int>(std::ceil(std::min({v0.x, v1.x, v2.x}) - 0.5f)), clipRect.left());
+    const int maxX = std::min(static_cast<int>(std::floor(std::max({v0.x, v1.x, v2.x}) + 0.5f)), clipRect.right());
+    const int minY = std::max(static_cast<int>(std::ceil(std::min({v0.y, v1.y, v2.y}) - 0.5f)), clipRect.top());
+    const int maxY = std::min(static_cast<int>(std::floor(std::max({v0.y, v1.y, v2.y}) + 0.5f)), clipRect.bottom());
+    if (minX > maxX || minY > maxY)
+        return;
+
+    const float w1StepX = (v2.y - v0.y) * invDenom;
+    const float w1StepY = -(v2.x - v0.x) * invDenom;
+    const float w2StepX = -(v1.y - v0.y) * invDenom;
+    const float w2StepY = (v1.x - v0.x) * invDenom;
+
+    // Weight offsets of every sample from the pixel center
+    Framebuffer &canvas      = drawData.canvas;
+    const int sampleCount    = canvas.getSampleCount();
+    const QVector2D *offsets = canvas.getSampleOffsets();
+    std::array<float, 8> w1Offsets{};
+    std::array<float, 8> w2Offsets{};
+    for (int i = 0; i < sampleCount; ++i)
     {
-        _a.draw(drawData);
-        _b.draw(drawData);
-        _c.draw(drawData);
+        w1Offsets[i] = offsets[i].x() * w1StepX + offsets[i].y() * w1StepY;
+        w2Offsets[i] = offsets[i].x() * w2StepX + offsets[i].y() * w2StepY;
     }
+
+    std::array<float, 8> sampleZ{};
+    for (int y = minY; y <= maxY; ++y)
+    {
+        const float dx = static_cast<float>(minX) - v0.x;
+        const float dy = static_cast<float>(y) - v0.y;
+        float w1       = (dx * (v2.y - v0.y) - (v2.x - v0.x) * dy) * invDenom;
+        float w2       = ((v1.x - v0.x) * dy - dx * (v1.y - v0.y)) * invDenom;
+
+        for (int x = minX; x <= maxX; ++x, w1 += w1StepX, w2 += w2StepX)
+        {
+            float *depth     = canvas.sampleDepth(x, y);
+            quint32 coverage = 0;
+            int firstCovered = -1;
+            for (int i = 0; i < sampleCount; ++i)
+            {
+                const float sw1 = w1 + w1Offsets[i];
+                const float sw2 = w2 + w2Offsets[i];
+                const float sw0 = 1.0f - sw1 - sw2;
+                if (sw0 < 0 || sw1 < 0 || sw2 < 0)
+                    continue;
+
+                sampleZ[i] = sw0 * v0.z + sw1 * v1.z + sw2 * v2.z;
+                if (sampleZ[i] < depth[i])
+                    continue;
+
+                coverage |= 1u << i;
+                if (firstCovered < 0)
+                    firstCovered = i;
+            }
+            if (coverage == 0)
+                continue;
+
+            // The pixel keeps the farthest sample depth, which is what the hierarchical Z expects
+            float farthest = std::numeric_limits<float>::max();
+            for (int i = 0; i < sampleCount; ++i)
+            {
+                if (coverage & (1u << i))
+                    depth[i] = sampleZ[i];
+                farthest = std::min(farthest, depth[i]);
+            }
+            drawData.depthAt(x, y) = farthest;
+
+            // Shaded once at the center, or at a covered sample when the center lies outside the triangle
+            float sw1 = w1;
+            float sw2 = w2;
+            if (w1 < 0 || w2 < 0 || 1.0f - w1 - w2 < 0)
+            {
+                sw1 += w1Offsets[firstCovered];
+                sw2 += w2Offsets[firstCovered];
+            }
+            shadeBarycentric(drawData, settings, vertices, QVector3D(1.0f - sw1 - sw2, sw1, sw2), lod, x, y);
+            canvas.storeSamples(x, y, coverage);
+        }
+    }
+}
+
+void Triangle::drawFragment(
+    DrawData &drawData, Settings &settings, const std::array<VertexStruct, 3> &vertices, const QVector3D &barycentric,
+    const SurfaceLod &lod, int x, int y
+)
+{
+    float z = barycentric.x() * vertices[0].z + barycentric.y() * vertices[1].z + barycentric.z() * vertices[2].z;
+
+    if (z < drawData.depthAt(x, y))
+        return;
+    drawData.depthAt(x, y) = z;
+
+    shadeBarycentric(drawData, settings, vertices, barycentric, lod, x, y);
+}
+
+void Triangle::shadeBarycentric(
+    DrawData &drawData, Settings &settings, const std::array<VertexStruct, 3> &vertices, const QVector3D &barycentric,
+    const SurfaceLod &lod, int x, int y
+)
+{
+    const QVector3D pos =
+        barycentric.x() * vertices[0].pos + barycentric.y() * vertices[1].pos + barycentric.z() * vertices[2].pos;
+    QVector3D normal = (barycentric.x() * vertices[0].normal + barycentric.y() * vertices[1].normal +
+                        barycentric.z() * vertices[2].normal)
+                           .normalized();
+    const float u = barycentric.x() * vertices[0].u + barycentric.y() * vertices[1].u + barycentric.z() * vertices[2].u;
+    const float v = barycentric.x() * vertices[0].v + barycentric.y() * vertices[1].v + barycentric.z() * vertices[2].v;
+
+    QVector3D uTangent;
+    QVector3D vTangent;
+    if (drawData.usesNormalMap())
+    {
+        uTangent = barycentric.x() * vertices[0].uTangent + barycentric.y() * vertices[1].uTangent +
+                   barycentric.z() * vertices[2].uTangent;
+        vTangent = barycentric.x() * vertices[0].vTangent + barycentric.y() * vertices[1].vTangent +
+                   barycentric.z() * vertices[2].vTangent;
+    }
+
+    QVector3D irradiance;
+    if (drawData.shadingContext.perVertexLighting)
+    {
+        irradiance = barycentric.x() * vertices[0].irradiance + barycentric.y() * vertices[1].irradiance +
+                     barycentric.z() * vertices[2].irradiance;
+    }
+
+    shadeFragment(drawData, settings, barycentric, pos, normal, u, v, uTangent, vTangent, irradiance, lod, x, y);
 }
 
-void Triangle::getNormalFromMap(
-    const DrawData &drawData, const std::array<VertexStruct, 3> &vertices, float u, float v, QVector3D &normal,
-    const QVector3D &uTangent, const QVector3D &vTangent
+void Triangle::shadeQuadLane(
+    DrawData &drawData, Settings &settings, const QuadFragments &fragments, int lane, const SurfaceLod &lod, int x,
+    int y
 )
 {
-    const int uX = qBound(0, static_cast<int>(u * drawData.normalMap->width()), drawData.normalMap->width() - 1);
-    const int vY = qBound(0, static_cast<int>(v * drawData.normalMap->height()), drawData.normalMap->height() - 1);
-    const QColor normalColor = drawData.normalMap->pixelColor(uX, vY);
-    const QVector3D textureVector =
-        QVector3D(
-            normalColor.redF() * 2.0f - 1.0f, normalColor.greenF() * 2.0f - 1.0f, normalColor.blueF() * 2.0f - 1.0f
-        )
+    const auto &attributes = fragments.attributes;
+
+    const QVector3D barycentric(fragments.w0[lane], fragments.w1[lane], fragments.w2[lane]);
+    const QVector3D pos(attributes[QuadPosX][lane], attributes[QuadPosY][lane], attributes[QuadPosZ][lane]);
+    const QVector3D normal =
+        QVector3D(attributes[QuadNormalX][lane], attributes[QuadNormalY][lane], attributes[QuadNormalZ][lane])
             .normalized();
-    QMatrix4x4 M3x3;
-    M3x3.setColumn(0, uTangent);
-    M3x3.setColumn(1, vTangent);
-    M3x3.setColumn(2, normal);
-    M3x3 = M3x3.inverted();
-
-    const QVector3D normalMapNormal = (M3x3 * textureVector).normalized();
-    normal                          = -textureVector;
+
+    QVector3D uTangent;
+    QVector3D vTangent;
+    if (drawData.usesNormalMap())
+    {
+        uTangent = QVector3D(
+            attributes[QuadUTangentX][lane], attributes[QuadUTangentY][lane], attributes[QuadUTangentZ][lane]
+        );
+        vTangent = QVector3D(
+            attributes[QuadVTangentX][lane], attributes[QuadVTangentY][lane], attributes[QuadVTangentZ][lane]
+        );
+    }
+
+    QVector3D irradiance;
+    if (drawData.shadingContext.perVertexLighting)
+    {
+        irradiance = QVector3D(
+            attributes[QuadIrradianceR][lane], attributes[QuadIrradianceG][lane], attributes[QuadIrradianceB][lane]
+        );
+    }
+
+    shadeFragment(
+        drawData, settings, barycentric, pos, normal, attributes[QuadU][lane], attributes[QuadV][lane], uTangent,
+        vTangent, irradiance, lod, x, y
+    );
 }
 
-QColor &Triangle::getColor(const DrawData &drawData, float u, float v, QColor &color)
+void Triangle::shadeFragment(
+    DrawData &drawData, Settings &settings, const QVector3D &barycentric, const QVector3D &pos, QVector3D normal,
+    float u, float v, const QVector3D &uTangent, const QVector3D &vTangent, const QVector3D &irradiance,
+    const SurfaceLod &lod, int x, int y
+)
 {
-    if (drawData.texture)
+    if (drawData.gBuffer)
+    {
+        drawData.gBuffer->write(x, y, drawData.materialIndex, pos, normal, u, v, uTangent, vTangent, lod);
+        return;
+    }
+
+    const TextureFilter filter = drawData.shadingContext.textureFilter;
+    if (drawData.shadingContext.perVertexLighting)
+    {
+        // Gouraud, only the texture is sampled per pixel
+        const QRgb color =
+            DrawUtils::sampleColor(drawData.texture, drawData.brushColor.rgb(), u, v, lod.texture, filter);
+        DrawUtils::drawLitPixel(drawData, irradiance, color, x, y);
+        return;
+    }
+
+    if (drawData.normalMap)
+    {
+        DrawUtils::sampleNormalMap(*drawData.normalMap, u, v, lod.normalMap, filter, normal, uTangent, vTangent);
+    }
+
+    const QRgb color = DrawUtils::sampleColor(drawData.texture, drawData.brushColor.rgb(), u, v, lod.texture, filter);
+
+    if (settings.triangleSettings.debugDraw)
     {
-        const int uX = qBound(0, static_cast<int>(u * drawData.texture->width()), drawData.texture->width() - 1);
-        const int vY = qBound(0, static_cast<int>(v * drawData.texture->height()), drawData.texture->height() - 1);
-        color        = drawData.texture->pixelColor(uX, vY);
+        drawPixelDebug(drawData, settings, y, x, barycentric, pos, normal);
     }
     else
     {
-        color = drawData.brushColor;
+        DrawUtils::drawPixel(drawData, pos, normal, color, x, y);
     }
-    return color;
 }
 
 void Triangle::drawPixelDebug(
@@ -265,15 +744,14 @@ void Triangle::drawPixelDebug(
     const QVector3D &normal
 )
 {
-    drawData.lightSources.clear();
     const float coeff = settings.triangleSettings.triangleEdgeDrawProximityCoef;
     if (barycentric.x() < coeff || barycentric.y() < coeff || barycentric.z() < coeff)
     {
-        DrawUtils::drawPixel(drawData, pos, normal, settings.triangleSettings.triangleEdgeColor, x, y);
+        DrawUtils::drawPixel(drawData, pos, normal, settings.triangleSettings.triangleEdgeColor.rgb(), x, y);
     }
     else
     {
-        DrawUtils::drawPixel(drawData, pos, normal, settings.triangleSettings.triangleFillColor, x, y);
+        DrawUtils::drawPixel(drawData, pos, normal, settings.triangleSettings.triangleFillColor.rgb(), x, y);
     }
 }
 
@@ -292,10 +770,3 @@ Triangle::computeBarycentricCoordinates(const QVector2D &p, const QVector2D &a,
 
     return QVector3D(w0, w1, w2);
 }
-
-void Triangle::transform(QMatrix4x4 &matrix)
-{
-    _a.transform(matrix);
-    _b.transform(matrix);
-    _c.transform(matrix);
-}
@@ -0,0 +1,115 @@
+//
+// Created by wookie on 11/30/24.
+//
+
+#include "utils/UpscaleUtils.h"
+#include <QVector>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+
+namespace
+{
+/// Source pixels and the weight of the second one along one axis
+struct Tap
+{
+    int first;
+    int second;
+    float weight;
+};
+
+QVector<Tap> computeTaps(int sourceSize, int targetSize)
+{
+    QVector<Tap> taps(targetSize);
+    const float ratio = static_cast<float>(sourceSize) / static_cast<float>(targetSize);
+    for (int i = 0; i < targetSize; ++i)
+    {
+        const float position = std::clamp((i + 0.5f) * ratio - 0.5f, 0.0f, static_cast<float>(sourceSize - 1));
+        const int first      = static_cast<int>(position);
+        taps[i]              = {first, std::min(first + 1, sourceSize - 1), position - static_cast<float>(first)};
+    }
+    return taps;
+}
+
+float luminance(QRgb color) { return 0.299f * qRed(color) + 0.587f * qGreen(color) + 0.114f * qBlue(color); }
+
+// Luminance difference, in 8-bit units, at which an edge-aware tap keeps half of its bilinear weight
+constexpr float EdgeSharpness = 24.0f;
+} // namespace
+
+void UpscaleUtils::upscale(const QImage &source, QImage &target, UpscaleFilter filter)
+{
+    Q_ASSERT(source.format() == QImage::Format_ARGB32 && target.format() == QImage::Format_ARGB32);
+    if (source.size() == target.size())
+    {
+        target = source.copy();
+        return;
+    }
+
+    const QVector<Tap> columns = computeTaps(source.width(), target.width());
+    const QVector<Tap> rows    = computeTaps(source.height(), target.height());
+    const int width            = target.width();
+    const bool edgeAware       = filter == UpscaleFilter::EdgeAware;
+
+    // bits() detaches, so it is taken once here and not by the workers
+    uchar *targetBits          = target.bits();
+    const qsizetype targetLine = target.bytesPerLine();
+
+    QVector<int> rowIndices(target.height());
+    std::iota(rowIndices.begin(), rowIndices.end(), 0);
+    QtConcurrent::blockingMap(
+        rowIndices,
+        [&](const int y)
+        {
+            const Tap &row    = rows[y];
+            const auto *upper = reinterpret_cast<const QRgb *>(source.constScanLine(row.first));
+            const auto *lower = reinterpret_cast<const QRgb *>(source.constScanLine(row.second));
+            auto *pixels      = reinterpret_cast<QRgb *>(targetBits + y * targetLine);
+
+            for (int x = 0; x < width; ++x)
+            {
+                const Tap &column   = columns[x];
+                const QRgb texels[] = {
+                    upper[column.first], upper[column.second], lower[column.first], lower[column.second]
+                };
+                float weights[] = {
+                    (1.0f - column.weight) * (1.0f - row.weight), column.weight * (1.0f - row.weight),
+                    (1.0f - column.weight) * row.weight, column.weight * row.weight
+                };
+
+                if (edgeAware)
+                {
+                    // Texels unlike the nearest one lie across an edge, blending them in would blur it
+                    const int nearest =
+                        static_cast<int>(std::max_element(std::begin(weights), std::end(weights)) - weights);
+                    const float reference = luminance(texels[nearest]);
+                    for (int i = 0; i < 4; ++i)
+                    {
+                        const float difference = std::abs(luminance(texels[i]) - reference) / EdgeSharpness;
+                        weights[i] /= 1.0f + difference * difference;
+                    }
+                }
+
+                float red   = 0.0f;
+                float green = 0.0f;
+                float blue  = 0.0f;
+                float total = 0.0f;
+                for (int i = 0; i < 4; ++i)
+                {
+                    red += weights[i] * qRed(texels[i]);
+                    green += weights[i] * qGreen(texels[i]);
+                    blue += weights[i] * qBlue(texels[i]);
+                    total += weights[i];
+                }
+
+                const float normalize = 1.0f / total;
+                pixels[x]             = qRgb(
+                    static_cast<int>(red * normalize + 0.5f), static_cast<int>(green * normalize + 0.5f),
+                    static_cast<int>(blue * normalize + 0.5f)
+                );
+            }
+        }
+    );
+}
@@ -29,8 +29,9 @@ void Vertex::draw(DrawData &drawData)
     const auto &settings = Settings::getInstance();
     QVector3D position   = _positionTransformed;
 
-    const int radiusX = std::max(1.0f, settings.graphicsEngineSettings.sizeX * settings.vertexSettings.radiusCoef);
-    const int radiusY = std::max(1.0f, settings.graphicsEngineSettings.sizeY * settings.vertexSettings.radiusCoef);
+    const float scale = settings.vertexSettings.radiusCoef * drawData.resolutionScale;
+    const int radiusX = std::max(1.0f, settings.graphicsEngineSettings.sizeX * scale);
+    const int radiusY = std::max(1.0f, settings.graphicsEngineSettings.sizeY * scale);
 
     DrawUtils::drawPoint(drawData, _positionTransformed, settings.vertexSettings.vertexColor, radiusX, radiusY);
 
@@ -0,0 +1,178 @@
+//
+// Created by wookie on 11/21/24.
+//
+
+#include "geometry/VertexBuffer.h"
+#include "models/ShadingContext.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+
+template <typename Function> void VertexBuffer::forEachBlock(Function function) const
+{
+    static constexpr int blockSize = 4096;
+
+    QVector<int> blockStarts;
+    for (int start = 0; start < size(); start += blockSize)
+    {
+        blockStarts.append(start);
+    }
+
+    // Contiguous blocks, so every worker streams through the attribute arrays
+    QtConcurrent::blockingMap(
+        blockStarts,
+        [this, &function](const int start)
+        {
+            function(start, std::min(start + blockSize, size()));
+        }
+    );
+}
+
+Vertex VertexBuffer::getVertex(int index) const
+{
+    Vertex vertex(_positions[index], _normals[index], _uTangents[index], _vTangents[index]);
+    vertex.setU(_uvs[index].x());
+    vertex.setV(_uvs[index].y());
+    vertex.setPositionTransformed(_positionsTransformed[index]);
+    vertex.setNormalTransformed(_normalsTransformed[index]);
+    vertex.setUTangentTransformed(_uTangentsTransformed[index]);
+    vertex.setVTangentTransformed(_vTangentsTransformed[index]);
+    return vertex;
+}
+
+int VertexBuffer::append(const QVector3D &position, const QVector3D &normal, float u, float v)
+{
+    _positions.append(position);
+    _normals.append(normal);
+    _uTangents.append(QVector3D(0, 0, 0));
+    _vTangents.append(QVector3D(0, 0, 0));
+    _uvs.append(QVector2D(u, v));
+
+    _positionsTransformed.append(position);
+    _normalsTransformed.append(normal);
+    _uTangentsTransformed.append(QVector3D(0, 0, 0));
+    _vTangentsTransformed.append(QVector3D(0, 0, 0));
+    _screenVerticesValid = false;
+    _positionVersion     = VersionUtils::next();
+    _version             = _positionVersion;
+
+    return _positions.size() - 1;
+}
+
+void VertexBuffer::reserve(int size)
+{
+    for (QVector<QVector3D> *attribute :
+         {&_positions, &_normals, &_uTangents, &_vTangents, &_positionsTransformed, &_normalsTransformed,
+          &_uTangentsTransformed, &_vTangentsTransformed})
+    {
+        attribute->reserve(size);
+    }
+    _uvs.reserve(size);
+}
+
+void VertexBuffer::clear()
+{
+    for (QVector<QVector3D> *attribute :
+         {&_positions, &_normals, &_uTangents, &_vTangents, &_positionsTransformed, &_normalsTransformed,
+          &_uTangentsTransformed, &_vTangentsTransformed})
+    {
+        attribute->clear();
+    }
+    _uvs.clear();
+    _screenVertices.clear();
+    _screenVerticesValid = false;
+    _positionVersion     = VersionUtils::next();
+    _version             = _positionVersion;
+}
+
+void VertexBuffer::transform(const QMatrix4x4 &matrix)
+{
+    // Detached once up front, the workers only write through the raw pointers
+    QVector3D *positions = _positionsTransformed.data();
+    QVector3D *normals   = _normalsTransformed.data();
+    QVector3D *uTangents = _uTangentsTransformed.data();
+    QVector3D *vTangents = _vTangentsTransformed.data();
+
+    forEachBlock(
+        [&](const int start, const int end)
+        {
+            for (int i = start; i < end; i++)
+            {
+                positions[i] = matrix * _positions.at(i);
+                normals[i]   = matrix.mapVector(_normals.at(i));
+                uTangents[i] = matrix.mapVector(_uTangents.at(i));
+                vTangents[i] = matrix.mapVector(_vTangents.at(i));
+            }
+        }
+    );
+
+    _screenVerticesValid = false;
+    _positionVersion     = VersionUtils::next();
+    _version             = _positionVersion;
+}
+
+void VertexBuffer::updateScreenVertices(int width, int height)
+{
+    if (_screenVerticesValid && _screenWidth == width && _screenHeight == height)
+        return;
+
+    _screenVertices.resize(size());
+    VertexStruct *screenVertices = _screenVertices.data();
+
+    forEachBlock(
+        [&](const int start, const int end)
+        {
+            for (int i = start; i < end; i++)
+            {
+                const QVector3D &pos   = _positionsTransformed.at(i);
+                const QVector2D &uv    = _uvs.at(i);
+                const QVector3D normal = _normalsTransformed.at(i).normalized();
+                QVector3D uTangent     = _uTangentsTransformed.at(i);
+                QVector3D vTangent     = _vTangentsTransformed.at(i);
+                orthonormalizeFrame(normal, uTangent, vTangent);
+
+                screenVertices[i] = {
+                    pos.x() * width, pos.y() * height, pos.z(), pos, normal, uv.x(), uv.y(), uTangent, vTangent
+                };
+            }
+        }
+    );
+
+    _screenWidth         = width;
+    _screenHeight        = height;
+    _screenVerticesValid = true;
+}
+
+void VertexBuffer::updateVertexLighting(const ShadingContext &shading)
+{
+    VertexStruct *screenVertices = _screenVertices.data();
+
+    forEachBlock(
+        [&shading, screenVertices](const int start, const int end)
+        {
+            for (int i = start; i < end; i++)
+            {
+                VertexStruct &vertex = screenVertices[i];
+                const int x          = static_cast<int>(std::floor(vertex.x));
+                const int y          = static_cast<int>(std::floor(vertex.y));
+                vertex.irradiance    = shading.irradiance(vertex.pos, vertex.normal, x, y);
+            }
+        }
+    );
+}
+
+void VertexBuffer::orthonormalizeFrame(const QVector3D &normal, QVector3D &uTangent, QVector3D &vTangent)
+{
+    // Gram-Schmidt against the normal; the bitangent keeps the handedness of the original vTangent
+    uTangent = uTangent - normal * QVector3D::dotProduct(normal, uTangent);
+    if (uTangent.lengthSquared() < 1e-12f)
+    {
+        // Degenerate UVs, any tangent perpendicular to the normal will do
+        const QVector3D axis = std::abs(normal.x()) < 0.9f ? QVector3D(1, 0, 0) : QVector3D(0, 1, 0);
+        uTangent             = QVector3D::crossProduct(axis, normal);
+    }
+    uTangent.normalize();
+
+    const QVector3D bitangent = QVector3D::crossProduct(normal, uTangent);
+    vTangent                  = QVector3D::dotProduct(bitangent, vTangent) < 0 ? -bitangent : bitangent;
+}
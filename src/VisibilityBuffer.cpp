@@ -0,0 +1,16 @@
+//
+// Created by wookie on 11/22/24.
+//
+
+#include "models/VisibilityBuffer.h"
+
+VisibilityBuffer::VisibilityBuffer(int width, int height) { resize(width, height); }
+
+void VisibilityBuffer::resize(int width, int height)
+{
+    _width  = width;
+    _height = height;
+
+    // QAtomicInteger value-initializes to Empty
+    _words.reset(new QAtomicInteger<Word>[width * height]);
+}
@@ -0,0 +1,78 @@
+//
+// Created by wookie on 12/1/24.
+//
+
+#include "utils/PowerUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Compares PowerTable against std::pow for every exponent the UI allows and a range of table sizes. The measured
+// error has to stay within PowerTable::maxError, the bound ShadingContext relies on when it picks the table.
+
+namespace
+{
+constexpr int MaxExponent = 40;
+constexpr int SampleCount = 100000;
+const int TableSizes[]    = {16, 64, 256, 1024, 4096};
+// Float rounding of the stored values and of the interpolation, on top of the interpolation error itself
+constexpr float RoundingTolerance = 1e-5f;
+
+int failures = 0;
+
+void check(bool condition, const char *what, int exponent, int size)
+{
+    if (condition)
+        return;
+    std::printf("FAILED: %s, exponent %d, table size %d\n", what, exponent, size);
+    ++failures;
+}
+
+/// Largest absolute difference to std::pow over evenly spaced points of [0, 1], table entries included
+float measureError(const PowerTable &table, int exponent)
+{
+    float error = 0.0f;
+    for (int i = 0; i <= SampleCount; i++)
+    {
+        const float x     = static_cast<float>(i) / SampleCount;
+        const float exact = static_cast<float>(std::pow(static_cast<double>(x), exponent));
+        error             = std::max(error, std::abs(table.evaluate(x) - exact));
+    }
+    return error;
+}
+} // namespace
+
+int main()
+{
+    for (const int size : TableSizes)
+    {
+        for (int exponent = 0; exponent <= MaxExponent; exponent++)
+        {
+            PowerTable table;
+            table.build(exponent, size);
+            check(table.getExponent() == exponent && table.getSize() == size, "table not built", exponent, size);
+
+            const float bound = std::max(0.0f, PowerTable::maxError(exponent, size));
+            const float error = measureError(table, exponent);
+            check(error <= bound + RoundingTolerance, "error above PowerTable::maxError", exponent, size);
+
+            // Outside [0, 1] the table clamps instead of extrapolating
+            check(table.evaluate(-0.5f) == table.evaluate(0.0f), "not clamped below 0", exponent, size);
+            check(table.evaluate(1.5f) == table.evaluate(1.0f), "not clamped above 1", exponent, size);
+            check(std::abs(table.evaluate(1.0f) - 1.0f) <= RoundingTolerance, "1^n is not 1", exponent, size);
+        }
+    }
+
+    // Building again with the same parameters keeps the table, a new exponent replaces it
+    PowerTable table;
+    table.build(8, 256);
+    const float before = table.evaluate(0.5f);
+    table.build(8, 256);
+    check(table.evaluate(0.5f) == before, "rebuilt with unchanged parameters", 8, 256);
+    table.build(9, 256);
+    check(table.getExponent() == 9 && table.evaluate(0.5f) < before, "not rebuilt for a new exponent", 9, 256);
+
+    if (failures == 0)
+        std::printf("PowerTable matches std::pow within maxError\n");
+    return failures == 0 ? 0 : 1;
+}